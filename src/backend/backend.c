@@ -110,6 +110,9 @@ void paint_all_new(session_t *ps, struct managed_win *t, bool ignore_damage) {
 		                               &ps->reg_paint, &ps->reg_visible);
 	}
 
+	// Shadows that don't need to wait for the windows below them
+	module_emit(MODEV_STAGE_SCREEN_SHADOW, ps, t);
+
 	// Windows are sorted from bottom to top
 	// Each window has a reg_ignore, which is the region obscured by all the windows
 	// on top of that window. This is used to reduce the number of pixels painted.
@@ -144,60 +147,7 @@ void paint_all_new(session_t *ps, struct managed_win *t, bool ignore_damage) {
 		module_emit(MODEV_STAGE_WIN_BLUR, ps, w);
 
 		// Draw shadow on target
-		if (w->shadow) {
-			assert(!(w->flags & WIN_FLAGS_SHADOW_NONE));
-			// Clip region for the shadow
-			// reg_shadow \in reg_paint
-			auto reg_shadow = win_extents_by_val(w);
-			pixman_region32_intersect(&reg_shadow, &reg_shadow, &ps->reg_paint);
-			if (!ps->o.wintype_option[w->window_type].full_shadow) {
-				pixman_region32_subtract(&reg_shadow, &reg_shadow, &w->reg_bound);
-			}
-
-			// Mask out the region we don't want shadow on
-			if (pixman_region32_not_empty(&ps->shadow_exclude_reg)) {
-				pixman_region32_subtract(&reg_shadow, &reg_shadow,
-				                         &ps->shadow_exclude_reg);
-			}
-
-			if (ps->o.xinerama_shadow_crop && w->xinerama_scr >= 0 &&
-			    w->xinerama_scr < ps->xinerama_nscrs) {
-				// There can be a window where number of screens is
-				// updated, but the screen number attached to the windows
-				// have not.
-				//
-				// Window screen number will be updated eventually, so
-				// here we just check to make sure we don't access out of
-				// bounds.
-				pixman_region32_intersect(
-				    &reg_shadow, &reg_shadow,
-				    &ps->xinerama_scr_regs[w->xinerama_scr]);
-			}
-
-			if (ps->o.transparent_clipping) {
-				// ref: <transparent-clipping-note>
-				pixman_region32_intersect(&reg_shadow, &reg_shadow,
-				                          &ps->reg_visible);
-			}
-
-			assert(w->shadow_image);
-			if (w->opacity == 1) {
-				ps->backend_data->ops->compose(
-				    ps->backend_data, w->shadow_image, w->g.x + w->shadow_dx,
-				    w->g.y + w->shadow_dy, &reg_shadow, &ps->reg_visible);
-			} else {
-				auto new_img = ps->backend_data->ops->copy(
-				    ps->backend_data, w->shadow_image, &ps->reg_visible);
-				ps->backend_data->ops->image_op(
-				    ps->backend_data, IMAGE_OP_APPLY_ALPHA_ALL, new_img,
-				    NULL, &ps->reg_visible, (double[]){w->opacity});
-				ps->backend_data->ops->compose(
-				    ps->backend_data, new_img, w->g.x + w->shadow_dx,
-				    w->g.y + w->shadow_dy, &reg_shadow, &ps->reg_visible);
-				ps->backend_data->ops->release_image(ps->backend_data, new_img);
-			}
-			pixman_region32_fini(&reg_shadow);
-		}
+		module_emit(MODEV_STAGE_WIN_SHADOW, ps, w);
 
 		// Set max brightness
 		if (ps->o.max_brightness < 1.0) {
@@ -7,6 +7,7 @@
 
 #include "utils/compiler.h"
 #include "utils/kernel.h"
+#include "utils/list.h"
 
 #include "config.h"
 #include "driver.h"
@@ -20,14 +21,33 @@ struct managed_win;
 struct ev_loop;
 struct backend_operations;
 
+/// Rough upper bound of the memory used by the shadows kept in the shadow cache
+#define SHADOW_CACHE_BUDGET (32 * 1024 * 1024)
+
+/// Shadows shared between windows, see `struct backend_shadow`. Entries are kept most
+/// recently used first.
+struct shadow_cache {
+	struct list_node entries;
+	/// Estimated size of the cached images, in bytes
+	size_t size;
+	unsigned int hits, misses;
+};
+
 typedef struct backend_base {
 	struct backend_operations *ops;
 	xcb_connection_t *c;
 	xcb_window_t root;
 	struct ev_loop *loop;
 
-	/// Whether the backend can accept new render request at the moment
+	/// Whether the backend can accept new render request at the moment. Backends
+	/// that complete frames asynchronously set this after `present`, and clear it
+	/// from `handle_events` once the frame is done.
 	bool busy;
+	/// Whether presenting a frame waits for the next vblank, so drawing frames back
+	/// to back is limited to the refresh rate.
+	bool paced;
+	/// Shadows rendered with this backend, see backend_render_shadow
+	struct shadow_cache shadow_cache;
 	// ...
 } backend_t;
 
@@ -52,6 +72,19 @@ enum image_operations {
 	IMAGE_OP_MAX_BRIGHTNESS,
 };
 
+/// An image to paint with `compose_batch`
+struct backend_compose_item {
+	void *image;
+	/// Multiplied with the opacity of the image
+	double opacity;
+	/// The top left corner of the image in the target
+	int dst_x, dst_y;
+	/// Size the image is tiled to, same as IMAGE_OP_RESIZE_TILE
+	int width, height;
+	/// The clip region, in target coordinates
+	region_t reg_paint;
+};
+
 struct backend_operations {
 	// ===========    Initialization    ===========
 
@@ -116,6 +149,16 @@ struct backend_operations {
 	void (*compose)(backend_t *backend_data, void *image_data, int dst_x, int dst_y,
 	                const region_t *reg_paint, const region_t *reg_visible);
 
+	/// Paint several images onto the rendering buffer, in order. The result is the
+	/// same as copying each image, applying its opacity and size to the copy with
+	/// `image_op`, and calling `compose` with it. Backends can skip the copies, and
+	/// share the setup between the images.
+	///
+	/// Optional, use backend_compose_batch to fall back to `compose`
+	void (*compose_batch)(backend_t *backend_data,
+	                      const struct backend_compose_item *items, int count,
+	                      const region_t *reg_visible);
+
 	/// Fill rectangle of the rendering buffer, mostly for debug purposes, optional.
 	void (*fill)(backend_t *backend_data, struct color, const region_t *clip);
 
@@ -197,8 +240,10 @@ struct backend_operations {
 	/// Let the backend hook into the event handling queue
 	/// Not implemented yet
 	void (*set_ready_callback)(backend_t *, backend_ready_callback_t cb);
-	/// Called right after the core has handled its events.
-	/// Not implemented yet
+	/// Called right after the core has handled its events. Backends can use this to
+	/// process their own X events (e.g. Present completion notifications).
+	///
+	/// Optional
 	void (*handle_events)(backend_t *);
 	// ===========         Misc         ============
 	/// Return the driver that is been used by the backend
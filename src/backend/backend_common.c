@@ -6,6 +6,8 @@
 #include <xcb/xcb_image.h>
 #include <xcb/xcb_renderutil.h>
 
+#include <test.h>
+
 #include "utils/kernel.h"
 #include "utils/utils.h"
 
@@ -58,8 +60,15 @@ xcb_render_picture_t solid_picture(xcb_connection_t *c, xcb_drawable_t d, bool a
 	return picture;
 }
 
-xcb_image_t *
-make_shadow(xcb_connection_t *c, const conv *kernel, double opacity, int width, int height) {
+/// Mirror the first `n` pixels of a `swidth` pixels wide row onto its end.
+static inline void mirror_row(uint8_t *row, int swidth, int n) {
+	for (int x = 0; x < n; x++) {
+		row[swidth - x - 1] = row[x];
+	}
+}
+
+void rasterize_shadow(const conv *kernel, double opacity, int width, int height,
+                      uint8_t *data, long sstride) {
 	/*
 	 * We classify shadows into 4 kinds of regions
 	 *    r = shadow radius
@@ -72,8 +81,11 @@ make_shadow(xcb_connection_t *c, const conv *kernel, double opacity, int width,
 	 * height-r +-----+---------+-----+
 	 *          |  1  |    2    |  1  |
 	 * height+r +-----+---------+-----+
+	 *
+	 * The shadow is symmetric, and all the rows crossing regions 2 and 3 are the
+	 * same. So every distinct row is computed once, then copied into place, which
+	 * leaves the bulk of the work to memset and memcpy.
 	 */
-	xcb_image_t *ximage;
 	const double *shadow_sum = kernel->rsum;
 	assert(shadow_sum);
 	// We only support square kernels for shadow
@@ -85,16 +97,6 @@ make_shadow(xcb_connection_t *c, const conv *kernel, double opacity, int width,
 	assert(d % 2 == 1);
 	assert(d > 0);
 
-	ximage = xcb_image_create_native(c, to_u16_checked(swidth), to_u16_checked(sheight),
-	                                 XCB_IMAGE_FORMAT_Z_PIXMAP, 8, 0, 0, NULL);
-	if (!ximage) {
-		log_error("failed to create an X image");
-		return 0;
-	}
-
-	unsigned char *data = ximage->data;
-	long sstride = ximage->stride;
-
 	// If the window body is smaller than the kernel, we do convolution directly
 	if (width < r * 2 && height < r * 2) {
 		for (int y = 0; y < sheight; y++) {
@@ -104,7 +106,7 @@ make_shadow(xcb_connection_t *c, const conv *kernel, double opacity, int width,
 				data[y * sstride + x] = (uint8_t)(sum * 255.0);
 			}
 		}
-		return ximage;
+		return;
 	}
 
 	if (height < r * 2) {
@@ -115,6 +117,100 @@ make_shadow(xcb_connection_t *c, const conv *kernel, double opacity, int width,
 		// +------+-------------+------+
 		// |      |             |      |
 		// +------+-------------+------+
+		for (int y = 0; y < sheight; y++) {
+			uint8_t *row = &data[y * sstride];
+			for (int x = 0; x < r * 2; x++) {
+				double sum = sum_kernel_normalized(kernel, d - x - 1,
+				                                   d - y - 1, d, height) *
+				             255.0;
+				row[x] = (uint8_t)sum;
+			}
+			mirror_row(row, swidth, r * 2);
+			double sum =
+			    sum_kernel_normalized(kernel, 0, d - y - 1, d, height) * 255.0;
+			memset(&row[r * 2], (uint8_t)sum, (size_t)(width - 2 * r));
+		}
+		return;
+	}
+
+	if (width < r * 2) {
+		// Similarly, for width smaller than kernel
+		for (int y = 0; y < r * 2; y++) {
+			uint8_t *row = &data[y * sstride];
+			for (int x = 0; x < swidth; x++) {
+				double sum = sum_kernel_normalized(kernel, d - x - 1,
+				                                   d - y - 1, width, d) *
+				             255.0;
+				row[x] = (uint8_t)sum;
+			}
+			memcpy(&data[(sheight - y - 1) * sstride], row, (size_t)swidth);
+		}
+		if (height > r * 2) {
+			uint8_t *row = &data[r * 2 * sstride];
+			for (int x = 0; x < swidth; x++) {
+				double sum =
+				    sum_kernel_normalized(kernel, d - x - 1, 0, width, d) * 255.0;
+				row[x] = (uint8_t)sum;
+			}
+			for (int y = r * 2 + 1; y < height; y++) {
+				memcpy(&data[y * sstride], row, (size_t)swidth);
+			}
+		}
+		return;
+	}
+
+	// Implies: width >= r * 2 && height >= r * 2
+
+	// Part 1 and part 2, top/bottom
+	for (int y = 0; y < r * 2; y++) {
+		uint8_t *row = &data[y * sstride];
+		for (int x = 0; x < r * 2; x++) {
+			double tmpsum = shadow_sum[y * d + x] * opacity * 255.0;
+			row[x] = (uint8_t)tmpsum;
+		}
+		mirror_row(row, swidth, r * 2);
+		double tmpsum = shadow_sum[d * y + d - 1] * opacity * 255.0;
+		memset(&row[r * 2], (uint8_t)tmpsum, (size_t)(width - r * 2));
+		memcpy(&data[(sheight - y - 1) * sstride], row, (size_t)swidth);
+	}
+
+	// Part 2, left/right and part 3
+	if (height > r * 2) {
+		uint8_t *row = &data[r * 2 * sstride];
+		for (int x = 0; x < r * 2; x++) {
+			double tmpsum = shadow_sum[d * (d - 1) + x] * opacity * 255.0;
+			row[x] = (uint8_t)tmpsum;
+		}
+		mirror_row(row, swidth, r * 2);
+		memset(&row[r * 2], (uint8_t)(255 * opacity), (size_t)(width - r * 2));
+		for (int y = r * 2 + 1; y < height; y++) {
+			memcpy(&data[y * sstride], row, (size_t)swidth);
+		}
+	}
+}
+
+/// The original, pixel by pixel, shadow rasterizer. Used to check the output of
+/// rasterize_shadow.
+static attr_unused void rasterize_shadow_reference(const conv *kernel, double opacity,
+                                                   int width, int height,
+                                                   uint8_t *data, long sstride) {
+	const double *shadow_sum = kernel->rsum;
+	int d = kernel->w;
+	int r = d / 2;
+	int swidth = width + r * 2, sheight = height + r * 2;
+
+	if (width < r * 2 && height < r * 2) {
+		for (int y = 0; y < sheight; y++) {
+			for (int x = 0; x < swidth; x++) {
+				double sum = sum_kernel_normalized(
+				    kernel, d - x - 1, d - y - 1, width, height);
+				data[y * sstride + x] = (uint8_t)(sum * 255.0);
+			}
+		}
+		return;
+	}
+
+	if (height < r * 2) {
 		for (int y = 0; y < sheight; y++) {
 			for (int x = 0; x < r * 2; x++) {
 				double sum = sum_kernel_normalized(kernel, d - x - 1,
@@ -130,10 +226,9 @@ make_shadow(xcb_connection_t *c, const conv *kernel, double opacity, int width,
 			memset(&data[y * sstride + r * 2], (uint8_t)sum,
 			       (size_t)(width - 2 * r));
 		}
-		return ximage;
+		return;
 	}
 	if (width < r * 2) {
-		// Similarly, for width smaller than kernel
 		for (int y = 0; y < r * 2; y++) {
 			for (int x = 0; x < swidth; x++) {
 				double sum = sum_kernel_normalized(kernel, d - x - 1,
@@ -150,17 +245,12 @@ make_shadow(xcb_connection_t *c, const conv *kernel, double opacity, int width,
 				data[y * sstride + x] = (uint8_t)sum;
 			}
 		}
-		return ximage;
+		return;
 	}
 
-	// Implies: width >= r * 2 && height >= r * 2
-
-	// Fill part 3
 	for (int y = r; y < height + r; y++) {
 		memset(data + sstride * y + r, (uint8_t)(255 * opacity), (size_t)width);
 	}
-
-	// Part 1
 	for (int y = 0; y < r * 2; y++) {
 		for (int x = 0; x < r * 2; x++) {
 			double tmpsum = shadow_sum[y * d + x] * opacity * 255.0;
@@ -170,16 +260,12 @@ make_shadow(xcb_connection_t *c, const conv *kernel, double opacity, int width,
 			data[y * sstride + (swidth - x - 1)] = (uint8_t)tmpsum;
 		}
 	}
-
-	// Part 2, top/bottom
 	for (int y = 0; y < r * 2; y++) {
 		double tmpsum = shadow_sum[d * y + d - 1] * opacity * 255.0;
 		memset(&data[y * sstride + r * 2], (uint8_t)tmpsum, (size_t)(width - r * 2));
 		memset(&data[(sheight - y - 1) * sstride + r * 2], (uint8_t)tmpsum,
 		       (size_t)(width - r * 2));
 	}
-
-	// Part 2, left/right
 	for (int x = 0; x < r * 2; x++) {
 		double tmpsum = shadow_sum[d * (d - 1) + x] * opacity * 255.0;
 		for (int y = r * 2; y < height; y++) {
@@ -187,27 +273,72 @@ make_shadow(xcb_connection_t *c, const conv *kernel, double opacity, int width,
 			data[y * sstride + (swidth - x - 1)] = (uint8_t)tmpsum;
 		}
 	}
+}
 
+TEST_CASE(rasterize_shadow) {
+	const int radii[] = {0, 1, 3, 12};
+	const int sizes[][2] = {{1, 1}, {4, 40}, {40, 4}, {24, 24}, {25, 80}, {100, 60}};
+	const double opacities[] = {1.0, 0.75, 0.3};
+	for (size_t i = 0; i < ARR_SIZE(radii); i++) {
+		conv *kernel = gaussian_kernel_autodetect_deviation(radii[i]);
+		sum_kernel_preprocess(kernel);
+		for (size_t j = 0; j < ARR_SIZE(sizes); j++) {
+			int width = sizes[j][0], height = sizes[j][1];
+			int swidth = width + radii[i] * 2, sheight = height + radii[i] * 2;
+			// Leave some padding at the end of the rows, like X images do
+			long stride = swidth + 7;
+			size_t size = (size_t)(stride * sheight);
+			uint8_t *expected = ccalloc(size, uint8_t),
+			        *got = ccalloc(size, uint8_t);
+			for (size_t k = 0; k < ARR_SIZE(opacities); k++) {
+				rasterize_shadow_reference(kernel, opacities[k], width,
+				                           height, expected, stride);
+				rasterize_shadow(kernel, opacities[k], width, height, got,
+				                 stride);
+				for (int y = 0; y < sheight; y++) {
+					TEST_EQUAL(memcmp(&expected[y * stride],
+					                  &got[y * stride], (size_t)swidth),
+					           0);
+				}
+			}
+			free(expected);
+			free(got);
+		}
+		free_conv(kernel);
+	}
+}
+
+xcb_image_t *
+make_shadow(xcb_connection_t *c, const conv *kernel, double opacity, int width, int height) {
+	xcb_image_t *ximage;
+	// We only support square kernels for shadow
+	assert(kernel->w == kernel->h);
+	int r = kernel->w / 2;
+	int swidth = width + r * 2, sheight = height + r * 2;
+
+	ximage = xcb_image_create_native(c, to_u16_checked(swidth), to_u16_checked(sheight),
+	                                 XCB_IMAGE_FORMAT_Z_PIXMAP, 8, 0, 0, NULL);
+	if (!ximage) {
+		log_error("failed to create an X image");
+		return 0;
+	}
+
+	rasterize_shadow(kernel, opacity, width, height, ximage->data, ximage->stride);
 	return ximage;
 }
 
 /**
- * Generate shadow <code>Picture</code> for a window.
+ * Turn an 8-bit shadow mask into an ARGB shadow <code>Picture</code>, colored with
+ * `shadow_pixel`.
  */
-bool build_shadow(xcb_connection_t *c, xcb_drawable_t d, double opacity, const int width,
-                  const int height, const conv *kernel, xcb_render_picture_t shadow_pixel,
-                  xcb_pixmap_t *pixmap, xcb_render_picture_t *pict) {
-	xcb_image_t *shadow_image = NULL;
+static bool build_shadow_from_mask(xcb_connection_t *c, xcb_drawable_t d,
+                                   const xcb_image_t *shadow_image,
+                                   xcb_render_picture_t shadow_pixel,
+                                   xcb_pixmap_t *pixmap, xcb_render_picture_t *pict) {
 	xcb_pixmap_t shadow_pixmap = XCB_NONE, shadow_pixmap_argb = XCB_NONE;
 	xcb_render_picture_t shadow_picture = XCB_NONE, shadow_picture_argb = XCB_NONE;
 	xcb_gcontext_t gc = XCB_NONE;
 
-	shadow_image = make_shadow(c, kernel, opacity, width, height);
-	if (!shadow_image) {
-		log_error("Failed to make shadow");
-		return false;
-	}
-
 	shadow_pixmap = x_create_pixmap(c, 8, d, shadow_image->width, shadow_image->height);
 	shadow_pixmap_argb =
 	    x_create_pixmap(c, 32, d, shadow_image->width, shadow_image->height);
@@ -237,7 +368,7 @@ bool build_shadow(xcb_connection_t *c, xcb_drawable_t d, double opacity, const i
 		log_error("X server request size limit is too restrictive, or the shadow "
 		          "image is too wide for us to send a single row of the shadow "
 		          "image. Shadow size: %dx%d",
-		          width, height);
+		          shadow_image->width, shadow_image->height);
 		goto shadow_picture_err;
 	}
 
@@ -262,16 +393,12 @@ bool build_shadow(xcb_connection_t *c, xcb_drawable_t d, double opacity, const i
 	*pict = shadow_picture_argb;
 
 	xcb_free_gc(c, gc);
-	xcb_image_destroy(shadow_image);
 	xcb_free_pixmap(c, shadow_pixmap);
 	xcb_render_free_picture(c, shadow_picture);
 
 	return true;
 
 shadow_picture_err:
-	if (shadow_image) {
-		xcb_image_destroy(shadow_image);
-	}
 	if (shadow_pixmap) {
 		xcb_free_pixmap(c, shadow_pixmap);
 	}
@@ -291,16 +418,31 @@ shadow_picture_err:
 	return false;
 }
 
-void *
-default_backend_render_shadow(backend_t *backend_data, int width, int height,
-                              const conv *kernel, double r, double g, double b, double a) {
-	xcb_pixmap_t shadow_pixel = solid_picture(backend_data->c, backend_data->root,
-	                                          true, 1, r, g, b),
-	             shadow = XCB_NONE;
-	xcb_render_picture_t pict = XCB_NONE;
+/**
+ * Generate shadow <code>Picture</code> for a window.
+ */
+bool build_shadow(xcb_connection_t *c, xcb_drawable_t d, double opacity, const int width,
+                  const int height, const conv *kernel, xcb_render_picture_t shadow_pixel,
+                  xcb_pixmap_t *pixmap, xcb_render_picture_t *pict) {
+	xcb_image_t *shadow_image = make_shadow(c, kernel, opacity, width, height);
+	if (!shadow_image) {
+		log_error("Failed to make shadow");
+		return false;
+	}
+
+	bool ret = build_shadow_from_mask(c, d, shadow_image, shadow_pixel, pixmap, pict);
+	xcb_image_destroy(shadow_image);
+	return ret;
+}
 
-	if (!build_shadow(backend_data->c, backend_data->root, a, width, height, kernel,
-	                  shadow_pixel, &shadow, &pict)) {
+/// Create a backend image from an 8-bit shadow mask
+static void *
+bind_shadow_mask(backend_t *backend_data, const xcb_image_t *mask,
+                 xcb_render_picture_t shadow_pixel) {
+	xcb_pixmap_t shadow = XCB_NONE;
+	xcb_render_picture_t pict = XCB_NONE;
+	if (!build_shadow_from_mask(backend_data->c, backend_data->root, mask,
+	                            shadow_pixel, &shadow, &pict)) {
 		return NULL;
 	}
 
@@ -311,10 +453,303 @@ default_backend_render_shadow(backend_t *backend_data, int width, int height,
 	return ret;
 }
 
+void *
+default_backend_render_shadow(backend_t *backend_data, int width, int height,
+                              const conv *kernel, double r, double g, double b, double a) {
+	xcb_render_picture_t shadow_pixel = solid_picture(
+	    backend_data->c, backend_data->root, true, 1, r, g, b);
+	xcb_image_t *mask = make_shadow(backend_data->c, kernel, a, width, height);
+	if (!mask) {
+		log_error("Failed to make shadow");
+		xcb_render_free_picture(backend_data->c, shadow_pixel);
+		return NULL;
+	}
+
+	void *ret = bind_shadow_mask(backend_data, mask, shadow_pixel);
+	xcb_image_destroy(mask);
+	xcb_render_free_picture(backend_data->c, shadow_pixel);
+	return ret;
+}
+
 void init_backend_base(struct backend_base *base, session_t *ps) {
 	base->c = ps->c;
 	base->loop = ps->loop;
 	base->root = ps->root;
 	base->busy = false;
+	base->paced = false;
 	base->ops = NULL;
+	list_init_head(&base->shadow_cache.entries);
+	base->shadow_cache.size = 0;
+	base->shadow_cache.hits = base->shadow_cache.misses = 0;
+}
+
+/// Copy a `width` x `height` part of an 8-bit mask, whose top left corner is at (x, y)
+static xcb_image_t *
+crop_shadow_mask(xcb_connection_t *c, const xcb_image_t *mask, int x, int y, int width,
+                 int height) {
+	xcb_image_t *ret =
+	    xcb_image_create_native(c, to_u16_checked(width), to_u16_checked(height),
+	                            XCB_IMAGE_FORMAT_Z_PIXMAP, 8, 0, 0, NULL);
+	if (!ret) {
+		return NULL;
+	}
+	for (int i = 0; i < height; i++) {
+		memcpy(&ret->data[(uint32_t)i * ret->stride],
+		       &mask->data[(uint32_t)(y + i) * mask->stride + (uint32_t)x],
+		       (size_t)width);
+	}
+	return ret;
+}
+
+/// Render the nine slices of the shadow of windows at least as large as `kernel`.
+static bool render_shadow_slices(backend_t *base, struct backend_shadow *s,
+                                 const conv *kernel, struct color c) {
+	int r = kernel->w / 2;
+	// The shadow of a (2r + 1) x (2r + 1) window has exactly one row and one column
+	// of the edges, and one pixel of the center.
+	xcb_image_t *mask = make_shadow(base->c, kernel, c.alpha, r * 2 + 1, r * 2 + 1);
+	if (!mask) {
+		log_error("Failed to make shadow");
+		return false;
+	}
+
+	xcb_render_picture_t shadow_pixel =
+	    solid_picture(base->c, base->root, true, 1, c.red, c.green, c.blue);
+	const struct {
+		void **image;
+		int x, y, width, height;
+	} slices[] = {
+	    {&s->image, 0, 0, r * 4 + 1, r * 4 + 1},
+	    {&s->top, r * 2, 0, 1, r * 2},
+	    {&s->bottom, r * 2, r * 2 + 1, 1, r * 2},
+	    {&s->left, 0, r * 2, r * 2, 1},
+	    {&s->right, r * 2 + 1, r * 2, r * 2, 1},
+	    {&s->center, r * 2, r * 2, 1, 1},
+	};
+	bool ret = true;
+	for (size_t i = 0; i < ARR_SIZE(slices) && ret; i++) {
+		if (slices[i].width == 0 || slices[i].height == 0) {
+			// No edges without a kernel
+			continue;
+		}
+		xcb_image_t *slice = crop_shadow_mask(base->c, mask, slices[i].x, slices[i].y,
+		                                      slices[i].width, slices[i].height);
+		if (slice) {
+			*slices[i].image = bind_shadow_mask(base, slice, shadow_pixel);
+			xcb_image_destroy(slice);
+		}
+		ret = slice && *slices[i].image;
+	}
+	xcb_image_destroy(mask);
+	xcb_render_free_picture(base->c, shadow_pixel);
+	return ret;
+}
+
+static void backend_free_shadow(backend_t *base, struct backend_shadow *s) {
+	void *images[] = {s->image, s->top, s->bottom, s->left, s->right, s->center};
+	for (size_t i = 0; i < ARR_SIZE(images); i++) {
+		if (images[i]) {
+			base->ops->release_image(base, images[i]);
+		}
+	}
+	free(s);
+}
+
+void backend_release_shadow(backend_t *base, struct backend_shadow *s) {
+	assert(s->refcount > 0);
+	if (--s->refcount == 0) {
+		backend_free_shadow(base, s);
+	}
+}
+
+static inline size_t backend_shadow_size(const struct backend_shadow *s) {
+	// Shadows are at most 4 bytes per pixel in all backends, the slices other than
+	// the corners are negligible
+	int size = s->sliced ? s->radius * 4 + 1 : 0;
+	return (size_t)max2(size, s->width + s->radius * 2) *
+	       (size_t)max2(size, s->height + s->radius * 2) * 4;
+}
+
+static void shadow_cache_evict(backend_t *base, struct backend_shadow *s) {
+	base->shadow_cache.size -= backend_shadow_size(s);
+	list_remove(&s->siblings);
+	backend_release_shadow(base, s);
+}
+
+struct backend_shadow *backend_render_shadow(backend_t *base, int width, int height,
+                                             const conv *kernel, struct color c) {
+	auto cache = &base->shadow_cache;
+	int r = kernel->w / 2;
+	bool sliced = width >= r * 2 && height >= r * 2;
+	if (sliced) {
+		// The same slices are used for every size
+		width = height = 0;
+	}
+	list_foreach(struct backend_shadow, s, &cache->entries, siblings) {
+		if (s->width != width || s->height != height || s->kernel != kernel ||
+		    memcmp(&s->color, &c, sizeof(c)) != 0) {
+			continue;
+		}
+		cache->hits++;
+		list_move_after(&s->siblings, &cache->entries);
+		s->refcount++;
+		return s;
+	}
+
+	cache->misses++;
+	auto s = ccalloc(1, struct backend_shadow);
+	s->width = width;
+	s->height = height;
+	s->radius = r;
+	s->sliced = sliced;
+	s->kernel = kernel;
+	s->color = c;
+	bool success;
+	if (sliced) {
+		success = render_shadow_slices(base, s, kernel, c);
+	} else {
+		s->image = base->ops->render_shadow(base, width, height, kernel, c.red,
+		                                    c.green, c.blue, c.alpha);
+		success = s->image != NULL;
+	}
+	if (!success) {
+		backend_free_shadow(base, s);
+		return NULL;
+	}
+	log_trace("Shadow cache miss for %dx%d, %u hits, %u misses so far", width,
+	          height, cache->hits, cache->misses);
+
+	// One reference for the cache, one for the caller
+	s->refcount = 2;
+	list_insert_after(&cache->entries, &s->siblings);
+	cache->size += backend_shadow_size(s);
+
+	// Evict the least recently used shadows. Windows using them keep their own
+	// references, so this only frees the shadows that are no longer used.
+	while (cache->size > SHADOW_CACHE_BUDGET &&
+	       !list_node_is_last(&cache->entries, &s->siblings)) {
+		shadow_cache_evict(
+		    base, list_entry(cache->entries.prev, struct backend_shadow, siblings));
+	}
+	return s;
+}
+
+void backend_clear_shadow_cache(backend_t *base) {
+	list_foreach_safe(struct backend_shadow, s, &base->shadow_cache.entries,
+	                  siblings) {
+		shadow_cache_evict(base, s);
+	}
+	assert(base->shadow_cache.size == 0);
+}
+
+void backend_compose_batch(backend_t *base, const struct backend_compose_item *items,
+                           int count, const region_t *reg_visible) {
+	if (count == 0) {
+		return;
+	}
+	if (base->ops->compose_batch) {
+		base->ops->compose_batch(base, items, count, reg_visible);
+		return;
+	}
+	for (int i = 0; i < count; i++) {
+		auto new_img = base->ops->copy(base, items[i].image, reg_visible);
+		if (items[i].opacity != 1) {
+			base->ops->image_op(base, IMAGE_OP_APPLY_ALPHA_ALL, new_img, NULL,
+			                    reg_visible, (double[]){items[i].opacity});
+		}
+		base->ops->image_op(base, IMAGE_OP_RESIZE_TILE, new_img, NULL, reg_visible,
+		                    (int[]){items[i].width, items[i].height});
+		base->ops->compose(base, new_img, items[i].dst_x, items[i].dst_y,
+		                   &items[i].reg_paint, reg_visible);
+		base->ops->release_image(base, new_img);
+	}
+}
+
+/// Add an image covering the `width` x `height` rectangle at (dst_x, dst_y) to `items`,
+/// unless nothing of it is painted. Returns the number of items added.
+static int add_shadow_item(struct backend_compose_item *items, void *image, double opacity,
+                           int dst_x, int dst_y, int width, int height,
+                           const region_t *reg_paint) {
+	if (!image || width <= 0 || height <= 0) {
+		return 0;
+	}
+	pixman_region32_init(&items->reg_paint);
+	pixman_region32_intersect_rect(&items->reg_paint, (region_t *)reg_paint, dst_x,
+	                               dst_y, (unsigned)width, (unsigned)height);
+	if (!pixman_region32_not_empty(&items->reg_paint)) {
+		pixman_region32_fini(&items->reg_paint);
+		return 0;
+	}
+	items->image = image;
+	items->opacity = opacity;
+	items->dst_x = dst_x;
+	items->dst_y = dst_y;
+	items->width = width;
+	items->height = height;
+	return 1;
+}
+
+int backend_shadow_compose_items(const struct backend_shadow *s, double opacity,
+                                 int dst_x, int dst_y, int width, int height,
+                                 const region_t *reg_paint,
+                                 struct backend_compose_item *items) {
+	int swidth = width + s->radius * 2, sheight = height + s->radius * 2;
+	if (!s->sliced) {
+		return add_shadow_item(items, s->image, opacity, dst_x, dst_y, swidth,
+		                       sheight, reg_paint);
+	}
+
+	// Corners are the size of the kernel, and are all taken from `image`, whose
+	// size is `corner_offset` + the size of the kernel.
+	int corner = s->radius * 2, corner_offset = s->radius * 2 + 1;
+	int image_size = corner + corner_offset;
+	int right = dst_x + swidth - corner, bottom = dst_y + sheight - corner;
+	int edge_width = swidth - corner * 2, edge_height = sheight - corner * 2;
+	int count = 0;
+	struct {
+		int x, y;
+	} corners[] = {
+	    {dst_x, dst_y},
+	    {right, dst_y},
+	    {dst_x, bottom},
+	    {right, bottom},
+	};
+	for (size_t i = 0; i < ARR_SIZE(corners); i++) {
+		region_t reg;
+		pixman_region32_init(&reg);
+		pixman_region32_intersect_rect(&reg, (region_t *)reg_paint, corners[i].x,
+		                               corners[i].y, (unsigned)corner,
+		                               (unsigned)corner);
+		// Position `image` so its matching corner lands on this corner
+		int image_x = corners[i].x == dst_x ? dst_x : right - corner_offset;
+		int image_y = corners[i].y == dst_y ? dst_y : bottom - corner_offset;
+		count += add_shadow_item(&items[count], s->image, opacity, image_x,
+		                         image_y, image_size, image_size, &reg);
+		pixman_region32_fini(&reg);
+	}
+
+	count += add_shadow_item(&items[count], s->top, opacity, dst_x + corner, dst_y,
+	                         edge_width, corner, reg_paint);
+	count += add_shadow_item(&items[count], s->bottom, opacity, dst_x + corner,
+	                         bottom, edge_width, corner, reg_paint);
+	count += add_shadow_item(&items[count], s->left, opacity, dst_x, dst_y + corner,
+	                         corner, edge_height, reg_paint);
+	count += add_shadow_item(&items[count], s->right, opacity, right, dst_y + corner,
+	                         corner, edge_height, reg_paint);
+	count += add_shadow_item(&items[count], s->center, opacity, dst_x + corner,
+	                         dst_y + corner, edge_width, edge_height, reg_paint);
+	assert(count <= BACKEND_SHADOW_MAX_ITEMS);
+	return count;
+}
+
+void backend_compose_shadow(backend_t *base, const struct backend_shadow *s,
+                            double opacity, int dst_x, int dst_y, int width, int height,
+                            const region_t *reg_paint, const region_t *reg_visible) {
+	struct backend_compose_item items[BACKEND_SHADOW_MAX_ITEMS];
+	int count = backend_shadow_compose_items(s, opacity, dst_x, dst_y, width,
+	                                         height, reg_paint, items);
+	backend_compose_batch(base, items, count, reg_visible);
+	for (int i = 0; i < count; i++) {
+		pixman_region32_fini(&items[i].reg_paint);
+	}
 }
@@ -9,12 +9,14 @@
 
 #include "config.h"
 #include "region.h"
+#include "utils/list.h"
 
 typedef struct session session_t;
 typedef struct win win;
 typedef struct conv conv;
 typedef struct backend_base backend_t;
 struct backend_operations;
+struct backend_compose_item;
 
 bool build_shadow(xcb_connection_t *, xcb_drawable_t, double opacity, int width,
                   int height, const conv *kernel, xcb_render_picture_t shadow_pixel,
@@ -26,6 +28,69 @@ xcb_render_picture_t solid_picture(xcb_connection_t *, xcb_drawable_t, bool argb
 xcb_image_t *
 make_shadow(xcb_connection_t *c, const conv *kernel, double opacity, int width, int height);
 
+/// Draw the alpha mask of the shadow of a `width` x `height` window into `data`. The
+/// mask is (width + d - 1) x (height + d - 1), d being the size of `kernel`, whose
+/// `rsum` must be computed.
+void rasterize_shadow(const conv *kernel, double opacity, int width, int height,
+                      uint8_t *data, long stride);
+
+/// A shadow, shared between all the windows using the same kernel and color.
+///
+/// Shadows of windows at least as large as the kernel are drawn from nine slices: the
+/// corners, four 1 pixel wide edges that are tiled along the sides, and a solid center.
+/// They take O(r^2) memory regardless of the window size, and windows can be resized
+/// without rendering their shadows again. Smaller windows get a full shadow image.
+struct backend_shadow {
+	struct list_node siblings;
+	unsigned int refcount;
+	/// Size of the window this shadow is for, 0 if the shadow is sliced
+	int width, height;
+	const conv *kernel;
+	struct color color;
+	/// Radius of the kernel
+	int radius;
+	bool sliced;
+	/// The full shadow if not sliced. Otherwise the shadow of a (2r + 1) x (2r + 1)
+	/// window, whose corners are the corners of the shadow
+	void *image;
+	void *top, *bottom, *left, *right, *center;
+};
+
+/// Get the shadow of a `width` x `height` window. Shadows with the same kernel and
+/// color are rendered once and shared. Kernels are compared by identity. The returned
+/// shadow must be released with `backend_release_shadow`.
+struct backend_shadow *backend_render_shadow(backend_t *base, int width, int height,
+                                             const conv *kernel, struct color c);
+
+void backend_release_shadow(backend_t *base, struct backend_shadow *s);
+
+/// Maximum number of images a shadow is painted with
+#define BACKEND_SHADOW_MAX_ITEMS 9
+
+/// Fill `items` with the images needed to paint the shadow of a `width` x `height`
+/// window, with its top left corner at (dst_x, dst_y), clipped to `reg_paint`. `items`
+/// must have room for BACKEND_SHADOW_MAX_ITEMS images. Returns the number of images,
+/// whose `reg_paint` the caller must fini.
+int backend_shadow_compose_items(const struct backend_shadow *s, double opacity,
+                                 int dst_x, int dst_y, int width, int height,
+                                 const region_t *reg_paint,
+                                 struct backend_compose_item *items);
+
+/// Paint the shadow of a `width` x `height` window, with its top left corner at
+/// (dst_x, dst_y). Arguments are the same as `backend_operations::compose`.
+void backend_compose_shadow(backend_t *base, const struct backend_shadow *s,
+                            double opacity, int dst_x, int dst_y, int width, int height,
+                            const region_t *reg_paint, const region_t *reg_visible);
+
+/// Drop all the shadows cached by `base`. Must be called before the backend is
+/// deinitialized.
+void backend_clear_shadow_cache(backend_t *base);
+
+/// Paint `items` with `compose_batch`, or with `compose` if the backend doesn't
+/// implement it.
+void backend_compose_batch(backend_t *base, const struct backend_compose_item *items,
+                           int count, const region_t *reg_visible);
+
 /// The default implementation of `is_win_transparent`, it simply looks at win::mode. So
 /// this is not suitable for backends that alter the content of windows
 bool default_is_win_transparent(void *, win *, void *);
@@ -32,6 +32,7 @@ struct backend_base *dummy_init(struct session *ps attr_unused) {
 	ret->loop = ps->loop;
 	ret->root = ps->root;
 	ret->busy = false;
+	ret->paced = false;
 	return ret;
 }
 
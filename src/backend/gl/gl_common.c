@@ -140,6 +140,168 @@ GLuint gl_create_program_from_str(const char *vert_shader_str, const char *frag_
 	return prog;
 }
 
+void gl_stream_buffer_init(struct gl_stream_buffer *sb) {
+	glGenVertexArrays(1, &sb->vao);
+	glGenBuffers(2, sb->bo);
+	sb->capacity[0] = sb->capacity[1] = 0;
+}
+
+void gl_stream_buffer_deinit(struct gl_stream_buffer *sb) {
+	if (sb->vao) {
+		glDeleteVertexArrays(1, &sb->vao);
+		sb->vao = 0;
+	}
+	glDeleteBuffers(2, sb->bo);
+	sb->bo[0] = sb->bo[1] = 0;
+}
+
+/// Upload `data` into the buffer currently bound to `target`, growing the buffer if
+/// needed. The old storage is always orphaned.
+static void gl_stream_buffer_store(GLenum target, GLsizeiptr *capacity, const void *data,
+                                   GLsizeiptr size) {
+	if (size > *capacity) {
+		GLsizeiptr new_capacity = max2(*capacity, 1024);
+		while (new_capacity < size) {
+			new_capacity *= 2;
+		}
+		*capacity = new_capacity;
+	}
+	glBufferData(target, *capacity, NULL, GL_STREAM_DRAW);
+	glBufferSubData(target, 0, size, data);
+}
+
+void gl_stream_buffer_upload(struct gl_stream_buffer *sb, const GLint *coord,
+                             GLsizeiptr coord_size, const GLuint *indices,
+                             GLsizeiptr indices_size) {
+	glBindVertexArray(sb->vao);
+	glBindBuffer(GL_ARRAY_BUFFER, sb->bo[0]);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sb->bo[1]);
+	gl_stream_buffer_store(GL_ARRAY_BUFFER, &sb->capacity[0], coord, coord_size);
+	gl_stream_buffer_store(GL_ELEMENT_ARRAY_BUFFER, &sb->capacity[1], indices,
+	                       indices_size);
+}
+
+void gl_vertex_scratch_reserve(struct gl_vertex_scratch *scratch, int nrects) {
+	if (nrects <= scratch->capacity) {
+		return;
+	}
+	int new_capacity = max2(scratch->capacity, 16);
+	while (new_capacity < nrects) {
+		new_capacity *= 2;
+	}
+	scratch->coord = crealloc(scratch->coord, new_capacity * 16);
+	scratch->indices = crealloc(scratch->indices, new_capacity * 6);
+	scratch->capacity = new_capacity;
+}
+
+void gl_vertex_scratch_free(struct gl_vertex_scratch *scratch) {
+	free(scratch->coord);
+	free(scratch->indices);
+	scratch->coord = NULL;
+	scratch->indices = NULL;
+	scratch->capacity = 0;
+}
+
+/// Rough estimate of the memory used by a texture, all formats we use are 4 bytes per
+/// pixel at most
+static inline size_t gl_texture_pool_entry_size(int width, int height) {
+	return (size_t)width * (size_t)height * 4;
+}
+
+static void gl_texture_pool_remove(struct gl_texture_pool *pool, int i) {
+	auto e = &pool->entries[i];
+	pool->size -= gl_texture_pool_entry_size(e->width, e->height);
+	pool->entries[i] = pool->entries[--pool->len];
+}
+
+/// Delete the least recently used textures until the pool fits in its budget
+static void gl_texture_pool_trim(struct gl_texture_pool *pool) {
+	while (pool->len > 0 && pool->size > pool->budget) {
+		int lru = 0;
+		for (int i = 1; i < pool->len; i++) {
+			if (pool->entries[i].last_used < pool->entries[lru].last_used) {
+				lru = i;
+			}
+		}
+		glDeleteFramebuffers(1, &pool->entries[lru].fbo);
+		glDeleteTextures(1, &pool->entries[lru].texture);
+		gl_texture_pool_remove(pool, lru);
+	}
+}
+
+void gl_texture_pool_init(struct gl_texture_pool *pool, size_t budget) {
+	*pool = (struct gl_texture_pool){.budget = budget};
+}
+
+void gl_texture_pool_deinit(struct gl_texture_pool *pool) {
+	pool->budget = 0;
+	gl_texture_pool_trim(pool);
+	free(pool->entries);
+	pool->entries = NULL;
+	pool->capacity = 0;
+}
+
+bool gl_texture_pool_get(struct gl_texture_pool *pool, int width, int height,
+                         GLenum format, GLuint *texture, GLuint *fbo) {
+	// Prefer the most recently used match, it is the most likely to still be
+	// resident
+	int found = -1;
+	for (int i = 0; i < pool->len; i++) {
+		auto e = &pool->entries[i];
+		if (e->width == width && e->height == height && e->format == format &&
+		    (found < 0 || e->last_used > pool->entries[found].last_used)) {
+			found = i;
+		}
+	}
+	if (found >= 0) {
+		*texture = pool->entries[found].texture;
+		*fbo = pool->entries[found].fbo;
+		gl_texture_pool_remove(pool, found);
+		return true;
+	}
+
+	*texture = gl_new_texture(GL_TEXTURE_2D);
+	if (!*texture) {
+		return false;
+	}
+	glBindTexture(GL_TEXTURE_2D, *texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, (GLint)format, width, height, 0, GL_BGRA,
+	             GL_UNSIGNED_BYTE, NULL);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenFramebuffers(1, fbo);
+	if (!*fbo) {
+		log_error("Failed to generate framebuffer object");
+		glDeleteTextures(1, texture);
+		*texture = 0;
+		return false;
+	}
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, *fbo);
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+	                       *texture, 0);
+	glDrawBuffer(GL_COLOR_ATTACHMENT0);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	return true;
+}
+
+void gl_texture_pool_put(struct gl_texture_pool *pool, int width, int height,
+                         GLenum format, GLuint texture, GLuint fbo) {
+	if (pool->len == pool->capacity) {
+		pool->capacity = max2(pool->capacity * 2, 8);
+		pool->entries = crealloc(pool->entries, pool->capacity);
+	}
+	pool->entries[pool->len++] = (struct gl_pooled_texture){
+	    .texture = texture,
+	    .fbo = fbo,
+	    .width = width,
+	    .height = height,
+	    .format = format,
+	    .last_used = pool->clock++,
+	};
+	pool->size += gl_texture_pool_entry_size(width, height);
+	gl_texture_pool_trim(pool);
+}
+
 static void gl_free_prog_main(gl_win_shader_t *pprogram) {
 	if (!pprogram)
 		return;
@@ -312,6 +474,31 @@ static GLuint gl_average_texture_color(backend_t *base, struct gl_image *img) {
 	return result_texture;
 }
 
+/// Set the uniforms of the window shader for painting `img`, with its opacity multiplied
+/// by `opacity`. The shader must be in use.
+static void
+gl_win_shader_set_image(const gl_win_shader_t *shader, const struct gl_image *img,
+                        double opacity) {
+	if (shader->unifm_opacity >= 0) {
+		glUniform1f(shader->unifm_opacity, (float)(img->opacity * opacity));
+	}
+	if (shader->unifm_invert_color >= 0) {
+		glUniform1i(shader->unifm_invert_color, img->color_inverted);
+	}
+	if (shader->unifm_tex >= 0) {
+		glUniform1i(shader->unifm_tex, 0);
+	}
+	if (shader->unifm_dim >= 0) {
+		glUniform1f(shader->unifm_dim, (float)img->dim);
+	}
+	if (shader->unifm_brightness >= 0) {
+		glUniform1i(shader->unifm_brightness, 1);
+	}
+	if (shader->unifm_max_brightness >= 0) {
+		glUniform1f(shader->unifm_max_brightness, (float)img->max_brightness);
+	}
+}
+
 /**
  * Render a region with texture data.
  *
@@ -338,24 +525,7 @@ static void _gl_compose(backend_t *base, struct gl_image *img, GLuint target,
 
 	assert(gd->win_shader.prog);
 	glUseProgram(gd->win_shader.prog);
-	if (gd->win_shader.unifm_opacity >= 0) {
-		glUniform1f(gd->win_shader.unifm_opacity, (float)img->opacity);
-	}
-	if (gd->win_shader.unifm_invert_color >= 0) {
-		glUniform1i(gd->win_shader.unifm_invert_color, img->color_inverted);
-	}
-	if (gd->win_shader.unifm_tex >= 0) {
-		glUniform1i(gd->win_shader.unifm_tex, 0);
-	}
-	if (gd->win_shader.unifm_dim >= 0) {
-		glUniform1f(gd->win_shader.unifm_dim, (float)img->dim);
-	}
-	if (gd->win_shader.unifm_brightness >= 0) {
-		glUniform1i(gd->win_shader.unifm_brightness, 1);
-	}
-	if (gd->win_shader.unifm_max_brightness >= 0) {
-		glUniform1f(gd->win_shader.unifm_max_brightness, (float)img->max_brightness);
-	}
+	gl_win_shader_set_image(&gd->win_shader, img, 1);
 
 	// log_trace("Draw: %d, %d, %d, %d -> %d, %d (%d, %d) z %d\n",
 	//          x, y, width, height, dx, dy, ptex->width, ptex->height, z);
@@ -366,17 +536,9 @@ static void _gl_compose(backend_t *base, struct gl_image *img, GLuint target,
 	glActiveTexture(GL_TEXTURE0);
 	glBindTexture(GL_TEXTURE_2D, img->inner->texture);
 
-	GLuint vao;
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
-
-	GLuint bo[2];
-	glGenBuffers(2, bo);
-	glBindBuffer(GL_ARRAY_BUFFER, bo[0]);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bo[1]);
-	glBufferData(GL_ARRAY_BUFFER, (long)sizeof(*coord) * nrects * 16, coord, GL_STATIC_DRAW);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, (long)sizeof(*indices) * nrects * 6,
-	             indices, GL_STATIC_DRAW);
+	gl_stream_buffer_upload(&gd->vertex_stream, coord,
+	                        (long)sizeof(*coord) * nrects * 16, indices,
+	                        (long)sizeof(*indices) * nrects * 6);
 
 	glEnableVertexAttribArray(vert_coord_loc);
 	glEnableVertexAttribArray(vert_in_texcoord_loc);
@@ -388,7 +550,6 @@ static void _gl_compose(backend_t *base, struct gl_image *img, GLuint target,
 	glDisableVertexAttribArray(vert_coord_loc);
 	glDisableVertexAttribArray(vert_in_texcoord_loc);
 	glBindVertexArray(0);
-	glDeleteVertexArrays(1, &vao);
 
 	// Cleanup
 	glBindTexture(GL_TEXTURE_2D, 0);
@@ -396,8 +557,6 @@ static void _gl_compose(backend_t *base, struct gl_image *img, GLuint target,
 	glDrawBuffer(GL_BACK);
 
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-	glDeleteBuffers(2, bo);
 
 	glUseProgram(0);
 
@@ -428,14 +587,105 @@ void gl_compose(backend_t *base, void *image_data, int dst_x, int dst_y,
 	// screen, with y axis pointing down. We have to do some coordinate conversion in
 	// this function
 
-	auto coord = ccalloc(nrects * 16, GLint);
-	auto indices = ccalloc(nrects * 6, GLuint);
+	gl_vertex_scratch_reserve(&gd->vertex_scratch, nrects);
 	x_rect_to_coords(nrects, rects, dst_x, dst_y, img->inner->height, gd->height,
-	                 img->inner->y_inverted, coord, indices);
-	_gl_compose(base, img, gd->back_fbo, coord, indices, nrects);
+	                 img->inner->y_inverted, gd->vertex_scratch.coord,
+	                 gd->vertex_scratch.indices);
+	_gl_compose(base, img, gd->back_fbo, gd->vertex_scratch.coord,
+	            gd->vertex_scratch.indices, nrects);
+}
+
+/// Paint all the items with a single upload of vertex data, and one draw call per
+/// item.
+void gl_compose_batch(backend_t *base, const struct backend_compose_item *items, int count,
+                      const region_t *reg_visible) {
+	struct gl_data *gd = (void *)base;
+	int total = 0;
+	for (int i = 0; i < count; i++) {
+		const struct gl_image *img = items[i].image;
+		if (img->max_brightness < 1.0) {
+			// The average color needed for max brightness is computed with
+			// other programs and buffers, don't bother batching.
+			for (int j = 0; j < count; j++) {
+				struct gl_image tmp = *(struct gl_image *)items[j].image;
+				tmp.opacity *= items[j].opacity;
+				gl_compose(base, &tmp, items[j].dst_x, items[j].dst_y,
+				           &items[j].reg_paint, reg_visible);
+			}
+			return;
+		}
+		total += pixman_region32_n_rects((region_t *)&items[i].reg_paint);
+	}
+	if (!total) {
+		// Nothing to paint
+		return;
+	}
 
-	free(indices);
-	free(coord);
+	// Coordinates of all the items go into one buffer, see gl_compose for the
+	// coordinate conversion
+	gl_vertex_scratch_reserve(&gd->vertex_scratch, total);
+	GLint *coord = gd->vertex_scratch.coord;
+	GLuint *indices = gd->vertex_scratch.indices;
+	int offset = 0;
+	for (int i = 0; i < count; i++) {
+		const struct gl_image *img = items[i].image;
+		int nrects;
+		const rect_t *rects =
+		    pixman_region32_rectangles((region_t *)&items[i].reg_paint, &nrects);
+		x_rect_to_coords(nrects, rects, items[i].dst_x, items[i].dst_y,
+		                 img->inner->height, gd->height, img->inner->y_inverted,
+		                 &coord[offset * 16], &indices[offset * 6]);
+		// x_rect_to_coords numbers vertices from 0
+		for (int j = offset * 6; j < (offset + nrects) * 6; j++) {
+			indices[j] += (GLuint)offset * 4;
+		}
+		offset += nrects;
+	}
+
+	assert(gd->win_shader.prog);
+	glUseProgram(gd->win_shader.prog);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+
+	gl_stream_buffer_upload(&gd->vertex_stream, coord, (long)sizeof(*coord) * total * 16,
+	                        indices, (long)sizeof(*indices) * total * 6);
+	glEnableVertexAttribArray(vert_coord_loc);
+	glEnableVertexAttribArray(vert_in_texcoord_loc);
+	glVertexAttribPointer(vert_coord_loc, 2, GL_INT, GL_FALSE, sizeof(GLint) * 4, NULL);
+	glVertexAttribPointer(vert_in_texcoord_loc, 2, GL_INT, GL_FALSE,
+	                      sizeof(GLint) * 4, (void *)(sizeof(GLint) * 2));
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, gd->back_fbo);
+
+	offset = 0;
+	for (int i = 0; i < count; i++) {
+		const struct gl_image *img = items[i].image;
+		int nrects = pixman_region32_n_rects((region_t *)&items[i].reg_paint);
+		if (img->inner->texture) {
+			gl_win_shader_set_image(&gd->win_shader, img, items[i].opacity);
+			glBindTexture(GL_TEXTURE_2D, img->inner->texture);
+			glDrawElements(GL_TRIANGLES, nrects * 6, GL_UNSIGNED_INT,
+			               (void *)(sizeof(GLuint) * (size_t)offset * 6));
+		} else {
+			log_error("Missing texture.");
+		}
+		offset += nrects;
+	}
+
+	glDisableVertexAttribArray(vert_coord_loc);
+	glDisableVertexAttribArray(vert_in_texcoord_loc);
+	glBindVertexArray(0);
+
+	// Cleanup
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glDrawBuffer(GL_BACK);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glUseProgram(0);
+
+	gl_check_err();
 }
 
 /**
@@ -516,21 +766,13 @@ static void _gl_fill(backend_t *base, struct color c, const region_t *clip, GLui
 	const rect_t *rect = pixman_region32_rectangles((region_t *)clip, &nrects);
 	struct gl_data *gd = (void *)base;
 
-	GLuint vao;
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
-
-	GLuint bo[2];
-	glGenBuffers(2, bo);
 	glUseProgram(gd->fill_shader.prog);
 	glUniform4f(gd->fill_shader.color_loc, (GLfloat)c.red, (GLfloat)c.green,
 	            (GLfloat)c.blue, (GLfloat)c.alpha);
-	glEnableVertexAttribArray(fill_vert_in_coord_loc);
-	glBindBuffer(GL_ARRAY_BUFFER, bo[0]);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bo[1]);
 
-	auto coord = ccalloc(nrects * 8, GLint);
-	auto indices = ccalloc(nrects * 6, GLuint);
+	gl_vertex_scratch_reserve(&gd->vertex_scratch, nrects);
+	GLint *coord = gd->vertex_scratch.coord;
+	GLuint *indices = gd->vertex_scratch.indices;
 	for (int i = 0; i < nrects; i++) {
 		GLint y1 = y_inverted ? height - rect[i].y2 : rect[i].y1,
 		      y2 = y_inverted ? height - rect[i].y1 : rect[i].y2;
@@ -545,24 +787,19 @@ static void _gl_fill(backend_t *base, struct color c, const region_t *clip, GLui
 		indices[i * 6 + 4] = (GLuint)i * 4 + 3;
 		indices[i * 6 + 5] = (GLuint)i * 4 + 0;
 	}
-	glBufferData(GL_ARRAY_BUFFER, nrects * 8 * (long)sizeof(*coord), coord, GL_STREAM_DRAW);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, nrects * 6 * (long)sizeof(*indices),
-	             indices, GL_STREAM_DRAW);
+	gl_stream_buffer_upload(&gd->vertex_stream, coord,
+	                        nrects * 8 * (long)sizeof(*coord), indices,
+	                        nrects * 6 * (long)sizeof(*indices));
 
+	glEnableVertexAttribArray(fill_vert_in_coord_loc);
 	glVertexAttribPointer(fill_vert_in_coord_loc, 2, GL_INT, GL_FALSE,
 	                      sizeof(*coord) * 2, (void *)0);
 	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target);
 	glDrawElements(GL_TRIANGLES, nrects * 6, GL_UNSIGNED_INT, NULL);
 	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 	glDisableVertexAttribArray(fill_vert_in_coord_loc);
 	glBindVertexArray(0);
-	glDeleteVertexArrays(1, &vao);
-
-	glDeleteBuffers(2, bo);
-	free(indices);
-	free(coord);
 }
 
 void gl_fill(backend_t *base, struct color c, const region_t *clip) {
@@ -583,7 +820,12 @@ void gl_release_image(backend_t *base, void *image_data) {
 	gl->release_user_data(base, wd->inner);
 	assert(wd->inner->user_data == NULL);
 
-	glDeleteTextures(1, &wd->inner->texture);
+	if (wd->inner->fbo) {
+		gl_texture_pool_put(&gl->texture_pool, wd->inner->width, wd->inner->height,
+		                    GL_RGBA8, wd->inner->texture, wd->inner->fbo);
+	} else {
+		glDeleteTextures(1, &wd->inner->texture);
+	}
 	glDeleteTextures(2, wd->inner->auxiliary_texture);
 	free(wd->inner);
 	free(wd);
@@ -610,7 +852,10 @@ const char *win_shader_glsl = GLSL(330,
 	uniform float max_brightness;
 
 	void main() {
-		vec4 c = texelFetch(tex, ivec2(texcoord), 0);
+		// Wrap around manually, texelFetch ignores the wrap mode of the
+		// texture. Needed by images resized with IMAGE_OP_RESIZE_TILE.
+		vec2 size = vec2(textureSize(tex, 0));
+		vec4 c = texelFetch(tex, ivec2(mod(texcoord, size)), 0);
 		if (invert_color) {
 			c = vec4(c.aaa - c.rgb, c.a);
 		}
@@ -658,9 +903,13 @@ bool gl_init(struct gl_data *gd, session_t *ps) {
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
+	gl_stream_buffer_init(&gd->vertex_stream);
+	gl_texture_pool_init(&gd->texture_pool, GL_TEXTURE_POOL_BUDGET);
+
+	glGenFramebuffers(1, &gd->temp_fbo);
 	glGenFramebuffers(1, &gd->back_fbo);
 	glGenTextures(1, &gd->back_texture);
-	if (!gd->back_fbo || !gd->back_texture) {
+	if (!gd->back_fbo || !gd->back_texture || !gd->temp_fbo) {
 		log_error("Failed to generate a framebuffer object");
 		return false;
 	}
@@ -722,6 +971,11 @@ bool gl_init(struct gl_data *gd, session_t *ps) {
 
 void gl_deinit(struct gl_data *gd) {
 	gl_free_prog_main(&gd->win_shader);
+	gl_stream_buffer_deinit(&gd->vertex_stream);
+	gl_vertex_scratch_free(&gd->vertex_scratch);
+	gl_texture_pool_deinit(&gd->texture_pool);
+	glDeleteFramebuffers(1, &gd->temp_fbo);
+	gd->temp_fbo = 0;
 
 	if (gd->logger) {
 		log_remove_target_tls(gd->logger);
@@ -750,34 +1004,30 @@ GLuint gl_new_texture(GLenum target) {
 }
 
 /// Decouple `img` from the image it references, also applies all the lazy operations
-static inline void gl_image_decouple(backend_t *base, struct gl_image *img) {
+static inline bool gl_image_decouple(backend_t *base, struct gl_image *img) {
 	if (img->inner->refcount == 1) {
-		return;
+		return true;
 	}
 
 	struct gl_data *gl = (void *)base;
-	auto new_tex = cmalloc(struct gl_texture);
+	GLuint texture, fbo;
+	if (!gl_texture_pool_get(&gl->texture_pool, img->inner->width, img->inner->height,
+	                         GL_RGBA8, &texture, &fbo)) {
+		log_error("Failed to allocate texture to decouple image");
+		return false;
+	}
 
-	glGenTextures(1, &new_tex->texture);
-	glBindTexture(GL_TEXTURE_2D, new_tex->texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, img->inner->width, img->inner->height, 0,
-	             GL_BGRA, GL_UNSIGNED_BYTE, NULL);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	auto new_tex = cmalloc(struct gl_texture);
+	new_tex->texture = texture;
+	new_tex->fbo = fbo;
+	new_tex->auxiliary_texture[0] = new_tex->auxiliary_texture[1] = 0;
 	new_tex->y_inverted = true;
 	new_tex->height = img->inner->height;
 	new_tex->width = img->inner->width;
 	new_tex->refcount = 1;
 	new_tex->user_data = gl->decouple_texture_user_data(base, img->inner->user_data);
 
-	GLuint fbo;
-	glGenFramebuffers(1, &fbo);
 	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo);
-	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
-	                       new_tex->texture, 0);
-	glDrawBuffer(GL_COLOR_ATTACHMENT0);
 	glClearColor(0, 0, 0, 0);
 	glClear(GL_COLOR_BUFFER_BIT);
 
@@ -803,7 +1053,6 @@ static inline void gl_image_decouple(backend_t *base, struct gl_image *img) {
 
 	_gl_compose(base, img, fbo, coord, (GLuint[]){0, 1, 2, 2, 3, 0}, 1);
 	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-	glDeleteFramebuffers(1, &fbo);
 
 	img->inner->refcount--;
 	img->inner = new_tex;
@@ -812,22 +1061,31 @@ static inline void gl_image_decouple(backend_t *base, struct gl_image *img) {
 	img->color_inverted = false;
 	img->dim = 0;
 	img->opacity = 1;
+	return true;
 }
 
 static void gl_image_apply_alpha(backend_t *base, struct gl_image *img,
                                  const region_t *reg_op, double alpha) {
 	glBlendFunc(GL_ONE, GL_CONSTANT_COLOR);
 	glBlendColor((GLclampf)alpha, (GLclampf)alpha, (GLclampf)alpha, (GLclampf)alpha);
-	GLuint fbo;
-	glGenFramebuffers(1, &fbo);
-	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo);
-	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
-	                       img->inner->texture, 0);
-	glDrawBuffer(GL_COLOR_ATTACHMENT0);
-	_gl_fill(base, (struct color){0, 0, 0, 0}, reg_op, 0, 0, false);
+	struct gl_data *gd = (void *)base;
+	GLuint fbo = img->inner->fbo;
+	if (!fbo) {
+		fbo = gd->temp_fbo;
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo);
+		glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+		                       GL_TEXTURE_2D, img->inner->texture, 0);
+		glDrawBuffer(GL_COLOR_ATTACHMENT0);
+	}
+	_gl_fill(base, (struct color){0, 0, 0, 0}, reg_op, fbo, 0, false);
 	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	if (fbo == gd->temp_fbo) {
+		// Don't keep the texture attached, it might be deleted
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo);
+		glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+		                       GL_TEXTURE_2D, 0, 0);
+	}
 	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-	glDeleteFramebuffers(1, &fbo);
 }
 
 void gl_present(backend_t *base, const region_t *region) {
@@ -835,8 +1093,9 @@ void gl_present(backend_t *base, const region_t *region) {
 
 	int nrects;
 	const rect_t *rect = pixman_region32_rectangles((region_t *)region, &nrects);
-	auto coord = ccalloc(nrects * 8, GLint);
-	auto indices = ccalloc(nrects * 6, GLuint);
+	gl_vertex_scratch_reserve(&gd->vertex_scratch, nrects);
+	GLint *coord = gd->vertex_scratch.coord;
+	GLuint *indices = gd->vertex_scratch.indices;
 	for (int i = 0; i < nrects; i++) {
 		// clang-format off
 		memcpy(&coord[i * 8],
@@ -855,30 +1114,17 @@ void gl_present(backend_t *base, const region_t *region) {
 	glUseProgram(gd->present_prog);
 	glBindTexture(GL_TEXTURE_2D, gd->back_texture);
 
-	GLuint vao;
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
+	gl_stream_buffer_upload(&gd->vertex_stream, coord,
+	                        (long)sizeof(GLint) * nrects * 8, indices,
+	                        (long)sizeof(GLuint) * nrects * 6);
 
-	GLuint bo[2];
-	glGenBuffers(2, bo);
 	glEnableVertexAttribArray(vert_coord_loc);
-	glBindBuffer(GL_ARRAY_BUFFER, bo[0]);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bo[1]);
-	glBufferData(GL_ARRAY_BUFFER, (long)sizeof(GLint) * nrects * 8, coord, GL_STREAM_DRAW);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, (long)sizeof(GLuint) * nrects * 6, indices,
-	             GL_STREAM_DRAW);
-
 	glVertexAttribPointer(vert_coord_loc, 2, GL_INT, GL_FALSE, sizeof(GLint) * 2, NULL);
 	glDrawElements(GL_TRIANGLES, nrects * 6, GL_UNSIGNED_INT, NULL);
 
+	glDisableVertexAttribArray(vert_coord_loc);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 	glBindVertexArray(0);
-	glDeleteBuffers(2, bo);
-	glDeleteVertexArrays(1, &vao);
-
-	free(coord);
-	free(indices);
 }
 
 /// stub for backend_operations::image_op
@@ -893,12 +1139,15 @@ bool gl_image_op(backend_t *base, enum image_operations op, void *image_data,
 		break;
 	case IMAGE_OP_APPLY_ALPHA_ALL: tex->opacity *= *(double *)arg; break;
 	case IMAGE_OP_APPLY_ALPHA:
-		gl_image_decouple(base, tex);
+		if (!gl_image_decouple(base, tex)) {
+			return false;
+		}
 		assert(tex->inner->refcount == 1);
 		gl_image_apply_alpha(base, tex, reg_op, *(double *)arg);
 		break;
 	case IMAGE_OP_RESIZE_TILE:
-		// texture is already set to repeat, so nothing else we need to do
+		// the window shader wraps texture coordinates, so nothing else we need to
+		// do
 		tex->ewidth = iargs[0];
 		tex->eheight = iargs[1];
 		break;
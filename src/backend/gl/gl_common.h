@@ -169,9 +169,55 @@ typedef struct {
 	GLint color_loc;
 } gl_fill_shader_t;
 
+/// A vertex array object with its vertex and index buffers, kept alive between draws.
+/// The buffers grow geometrically, and are orphaned on every upload, so the driver can
+/// give us fresh storage instead of stalling on draws still using the old data.
+struct gl_stream_buffer {
+	GLuint vao;
+	/// Vertex buffer and index buffer
+	GLuint bo[2];
+	/// Allocated sizes of the buffers in `bo`, in bytes
+	GLsizeiptr capacity[2];
+};
+
+/// CPU side scratch space for building vertex coordinates and indices, reused between
+/// draws. Has room for `capacity` rectangles, in the layout of x_rect_to_coords.
+struct gl_vertex_scratch {
+	GLint *coord;
+	GLuint *indices;
+	int capacity;
+};
+
+/// Default memory budget of the texture pool, in bytes
+#define GL_TEXTURE_POOL_BUDGET (64 * 1024 * 1024)
+
+/// A texture, and a framebuffer object with the texture attached to it
+struct gl_pooled_texture {
+	GLuint texture, fbo;
+	int width, height;
+	/// Internal format of the texture
+	GLenum format;
+	/// Value of the pool clock when this texture was returned to the pool
+	uint64_t last_used;
+};
+
+/// Textures and framebuffers which are no longer in use, kept for reuse by later
+/// image operations. Once the pool holds more than `budget` bytes, the least
+/// recently returned textures are deleted.
+struct gl_texture_pool {
+	struct gl_pooled_texture *entries;
+	int len, capacity;
+	/// Estimated memory used by the textures in the pool, in bytes
+	size_t size, budget;
+	uint64_t clock;
+};
+
 struct gl_texture {
 	int refcount;
 	GLuint texture;
+	/// Framebuffer object `texture` is attached to, if the texture comes from the
+	/// texture pool. 0 otherwise.
+	GLuint fbo;
 	int width, height;
 	bool y_inverted;
 
@@ -202,6 +248,13 @@ struct gl_data {
 	gl_fill_shader_t fill_shader;
 	GLuint back_texture, back_fbo;
 	GLuint present_prog;
+	/// Vertex data for compose, fill and present
+	struct gl_stream_buffer vertex_stream;
+	struct gl_vertex_scratch vertex_scratch;
+	/// Recycled textures for decoupled images
+	struct gl_texture_pool texture_pool;
+	/// Framebuffer object for drawing into textures that don't have their own
+	GLuint temp_fbo;
 
 	/// Called when an gl_texture is decoupled from the texture it refers. Returns
 	/// the decoupled user_data
@@ -228,6 +281,9 @@ GLuint gl_create_program_from_str(const char *vert_shader_str, const char *frag_
 void gl_compose(backend_t *, void *ptex, int dst_x, int dst_y, const region_t *reg_tgt,
                 const region_t *reg_visible);
 
+void gl_compose_batch(backend_t *, const struct backend_compose_item *items, int count,
+                      const region_t *reg_visible);
+
 void gl_resize(struct gl_data *, int width, int height);
 
 bool gl_init(struct gl_data *gd, session_t *);
@@ -247,6 +303,29 @@ void gl_fill(backend_t *base, struct color, const region_t *clip);
 
 void gl_present(backend_t *base, const region_t *);
 
+void gl_stream_buffer_init(struct gl_stream_buffer *);
+void gl_stream_buffer_deinit(struct gl_stream_buffer *);
+/// Bind the vertex array of `sb`, and replace the content of its buffers with the
+/// given vertex coordinates and indices. The vertex array stays bound.
+void gl_stream_buffer_upload(struct gl_stream_buffer *sb, const GLint *coord,
+                             GLsizeiptr coord_size, const GLuint *indices,
+                             GLsizeiptr indices_size);
+
+/// Make sure `scratch` has room for at least `nrects` rectangles
+void gl_vertex_scratch_reserve(struct gl_vertex_scratch *scratch, int nrects);
+void gl_vertex_scratch_free(struct gl_vertex_scratch *scratch);
+
+void gl_texture_pool_init(struct gl_texture_pool *pool, size_t budget);
+void gl_texture_pool_deinit(struct gl_texture_pool *pool);
+/// Get a texture of the given size and internal format, with a framebuffer attached to
+/// it, either from the pool or newly created. Content of the texture is undefined.
+/// @return true on success
+bool gl_texture_pool_get(struct gl_texture_pool *pool, int width, int height,
+                         GLenum format, GLuint *texture, GLuint *fbo);
+/// Return a texture and its framebuffer to the pool. The pool takes ownership of both.
+void gl_texture_pool_put(struct gl_texture_pool *pool, int width, int height,
+                         GLenum format, GLuint texture, GLuint fbo);
+
 static inline void gl_delete_texture(GLuint texture) {
 	glDeleteTextures(1, &texture);
 }
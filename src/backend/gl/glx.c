@@ -345,7 +345,9 @@ static backend_t *glx_init(session_t *ps) {
 	gd->gl.release_user_data = glx_release_image;
 
 	if (ps->o.vsync) {
-		if (!glx_set_swap_interval(1, ps->dpy, tgt)) {
+		if (glx_set_swap_interval(1, ps->dpy, tgt)) {
+			gd->gl.base.paced = true;
+		} else {
 			log_error("Failed to enable vsync.");
 		}
 	} else {
@@ -491,6 +493,7 @@ struct backend_operations glx_ops = {
     .bind_pixmap = glx_bind_pixmap,
     .release_image = gl_release_image,
     .compose = gl_compose,
+    .compose_batch = gl_compose_batch,
     .image_op = gl_image_op,
     .copy = gl_copy,
     .is_image_transparent = gl_is_image_transparent,
@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright (c) Yuxuan Shui <yshuiv7@gmail.com>
 #include "picom_assert.h"
+#include <inttypes.h>
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
@@ -19,50 +20,258 @@
 #include "x.h"
 #include "types.h"
 
-struct _xrender_image_data {
+struct _xrender_image_data_inner {
 	// Pixmap that the client window draws to,
 	// it will contain the content of client window.
 	xcb_pixmap_t pixmap;
 	// A Picture links to the Pixmap
 	xcb_render_picture_t pict;
 	int width, height;
+	xcb_visualid_t visual;
+	uint8_t depth;
+	// Whether we own the pixmap, i.e. it should be freed with the image
+	bool owned;
+	// If not NULL, the pixmap comes from the offscreen pixmap pool, and should be
+	// returned to it instead of being freed. The pixmap might be larger than the
+	// image.
+	struct xrender_pooled_pixmap *pooled;
+	int refcount;
+};
+
+struct _xrender_image_data {
+	// The pixmap data, shared between copies of the same image. It is only
+	// duplicated when an operation needs to modify the pixels.
+	struct _xrender_image_data_inner *inner;
 	// The effective size of the image
 	int ewidth, eheight;
 	bool has_alpha;
+	// Lazy operations, applied when the image is composed
 	double opacity;
-	xcb_visualid_t visual;
-	uint8_t depth;
-	bool owned;
+	double dim;
+	bool color_inverted;
 };
 
+/// Round a pixmap dimension up to its size class, so windows of slightly different
+/// sizes can share pooled pixmaps.
+static inline int pixmap_pool_size_class(int size) {
+	return min2((size + 63) & ~63, UINT16_MAX);
+}
+
+static void pixmap_pool_free_entry(struct _xrender_data *xd,
+                                   struct xrender_pooled_pixmap *entry) {
+	list_remove(&entry->siblings);
+	xd->pixmap_pool_len--;
+	xcb_render_free_picture(xd->base.c, entry->pict);
+	xcb_free_pixmap(xd->base.c, entry->pixmap);
+	free(entry);
+}
+
+/// Get an offscreen pixmap of at least the given size, and a picture for it, from the
+/// pool. A new one is created if there is no suitable idle pixmap. Content of the
+/// pixmap is undefined.
+static struct xrender_pooled_pixmap *
+pixmap_pool_get(struct _xrender_data *xd, uint8_t depth, xcb_visualid_t visual,
+                int width, int height) {
+	width = pixmap_pool_size_class(width);
+	height = pixmap_pool_size_class(height);
+	list_foreach(struct xrender_pooled_pixmap, i, &xd->pixmap_pool, siblings) {
+		if (i->depth == depth && i->visual == visual && i->width == width &&
+		    i->height == height) {
+			list_remove(&i->siblings);
+			xd->pixmap_pool_len--;
+			xd->pixmap_pool_hits++;
+			x_clear_picture_clip_region(xd->base.c, i->pict);
+			return i;
+		}
+	}
+
+	xd->pixmap_pool_misses++;
+	auto entry = ccalloc(1, struct xrender_pooled_pixmap);
+	entry->depth = depth;
+	entry->visual = visual;
+	entry->width = width;
+	entry->height = height;
+	entry->pixmap = x_create_pixmap(xd->base.c, depth, xd->base.root, width, height);
+	if (entry->pixmap == XCB_NONE) {
+		log_error("Failed to create offscreen pixmap");
+		free(entry);
+		return NULL;
+	}
+	entry->pict = x_create_picture_with_visual_and_pixmap(xd->base.c, visual,
+	                                                      entry->pixmap, 0, NULL);
+	if (entry->pict == XCB_NONE) {
+		log_error("Failed to create picture for offscreen pixmap");
+		xcb_free_pixmap(xd->base.c, entry->pixmap);
+		free(entry);
+		return NULL;
+	}
+	return entry;
+}
+
+/// Return a pixmap to the pool
+static void pixmap_pool_put(struct _xrender_data *xd, struct xrender_pooled_pixmap *entry) {
+	entry->last_used = ev_now(xd->base.loop);
+	list_insert_after(&xd->pixmap_pool, &entry->siblings);
+	xd->pixmap_pool_len++;
+	if (xd->pixmap_pool_len > XRENDER_POOL_MAX_IDLE) {
+		pixmap_pool_free_entry(
+		    xd, list_entry(xd->pixmap_pool.prev, struct xrender_pooled_pixmap, siblings));
+	}
+	if (!ev_is_active(&xd->pixmap_pool_timer)) {
+		ev_timer_again(xd->base.loop, &xd->pixmap_pool_timer);
+	}
+}
+
+/// Free pixmaps that have been idle for too long. Least recently used pixmaps are at
+/// the end of the list.
+static void pixmap_pool_trim(struct _xrender_data *xd, ev_tstamp now) {
+	while (!list_is_empty(&xd->pixmap_pool)) {
+		auto last = list_entry(xd->pixmap_pool.prev, struct xrender_pooled_pixmap,
+		                       siblings);
+		if (now - last->last_used < XRENDER_POOL_IDLE_TIMEOUT) {
+			break;
+		}
+		pixmap_pool_free_entry(xd, last);
+	}
+}
+
+static void pixmap_pool_timer_callback(EV_P_ ev_timer *w, int revents attr_unused) {
+	struct _xrender_data *xd = container_of(w, struct _xrender_data, pixmap_pool_timer);
+	pixmap_pool_trim(xd, ev_now(EV_A));
+	log_debug("xrender: offscreen pixmap pool: %d idle, %" PRIu64 " hits, %" PRIu64
+	          " misses",
+	          xd->pixmap_pool_len, xd->pixmap_pool_hits, xd->pixmap_pool_misses);
+	if (list_is_empty(&xd->pixmap_pool)) {
+		ev_timer_stop(EV_A_ w);
+	}
+}
+
+/// Render the inverted content of `inner` into `dst`
+static void render_inverted(struct _xrender_data *xd,
+                            const struct _xrender_image_data_inner *inner,
+                            bool has_alpha, xcb_render_picture_t dst) {
+	auto c = xd->base.c;
+	const auto tmpw = to_u16_checked(inner->width);
+	const auto tmph = to_u16_checked(inner->height);
+	x_clear_picture_clip_region(c, inner->pict);
+	xcb_render_composite(c, XCB_RENDER_PICT_OP_SRC, inner->pict, XCB_NONE, dst, 0, 0,
+	                     0, 0, 0, 0, tmpw, tmph);
+	xcb_render_composite(c, XCB_RENDER_PICT_OP_DIFFERENCE, xd->white_pixel, XCB_NONE,
+	                     dst, 0, 0, 0, 0, 0, 0, tmpw, tmph);
+	if (has_alpha) {
+		// DIFFERENCE made the picture opaque, restore the original alpha
+		xcb_render_composite(c, XCB_RENDER_PICT_OP_IN_REVERSE, inner->pict,
+		                     XCB_NONE, dst, 0, 0, 0, 0, 0, 0, tmpw, tmph);
+	}
+}
+
 static void compose(backend_t *base, void *img_data, int dst_x, int dst_y,
                     const region_t *reg_paint, const region_t *reg_visible) {
 	struct _xrender_data *xd = (void *)base;
 	struct _xrender_image_data *img = img_data;
-	uint8_t op = (img->has_alpha ? XCB_RENDER_PICT_OP_OVER : XCB_RENDER_PICT_OP_SRC);
-	auto alpha_pict = xd->alpha_pict[(int)(img->opacity * MAX_ALPHA)];
 	region_t reg;
 	pixman_region32_init(&reg);
 	pixman_region32_intersect(&reg, (region_t *)reg_paint, (region_t *)reg_visible);
 
 	// Clip region of rendered_pict might be set during rendering, clear it to make
 	// sure we get everything into the buffer
-	x_clear_picture_clip_region(base->c, img->pict);
+	x_clear_picture_clip_region(base->c, img->inner->pict);
+
+	xcb_render_picture_t src = img->inner->pict;
+	struct xrender_pooled_pixmap *inverted = NULL;
+	if (img->color_inverted) {
+		inverted = pixmap_pool_get(xd, img->inner->depth, img->inner->visual,
+		                           img->inner->width, img->inner->height);
+		if (inverted) {
+			render_inverted(xd, img->inner, img->has_alpha, inverted->pict);
+			src = inverted->pict;
+		}
+	}
+
+	// Images resized with IMAGE_OP_RESIZE_TILE repeat their content
+	bool tiled = img->ewidth > img->inner->width || img->eheight > img->inner->height;
+	xcb_render_picture_t tile = XCB_NONE;
+	if (tiled && (img->inner->pooled || inverted)) {
+		// Pooled pixmaps can be larger than the image, repeating them would
+		// repeat what is past its end. Repeat a copy of the exact size instead.
+		const xcb_render_create_picture_value_list_t pa = {
+		    .repeat = XCB_RENDER_REPEAT_NORMAL,
+		};
+		const int iw = img->inner->width, ih = img->inner->height;
+		tile = x_create_picture_with_visual(base->c, base->root, iw, ih,
+		                                    img->inner->visual,
+		                                    XCB_RENDER_CP_REPEAT, &pa);
+		if (tile == XCB_NONE) {
+			log_error("Failed to create picture for tiling");
+			xcb_render_change_picture(base->c, src, XCB_RENDER_CP_REPEAT,
+			                          (uint32_t[]){XCB_RENDER_REPEAT_NORMAL});
+		} else {
+			xcb_render_composite(base->c, XCB_RENDER_PICT_OP_SRC, src,
+			                     XCB_NONE, tile, 0, 0, 0, 0, 0, 0,
+			                     to_u16_checked(iw), to_u16_checked(ih));
+			src = tile;
+		}
+	} else if (tiled) {
+		xcb_render_change_picture(base->c, src, XCB_RENDER_CP_REPEAT,
+		                          (uint32_t[]){XCB_RENDER_REPEAT_NORMAL});
+	}
+	const int16_t x = to_i16_checked(dst_x), y = to_i16_checked(dst_y);
+	const uint16_t w = to_u16_checked(img->ewidth), h = to_u16_checked(img->eheight);
+	x_set_picture_clip_region(base->c, xd->render_pict, 0, 0, &reg);
+	if (img->dim == 0) {
+		uint8_t op = (img->has_alpha ? XCB_RENDER_PICT_OP_OVER : XCB_RENDER_PICT_OP_SRC);
+		auto alpha_pict = xd->alpha_pict[(int)(img->opacity * MAX_ALPHA)];
+		xcb_render_composite(base->c, op, src, alpha_pict, xd->render_pict, 0, 0,
+		                     0, 0, x, y, w, h);
+	} else if (!img->has_alpha) {
+		// The image is opaque, dimming it just scales its color
+		auto alpha_pict = xd->alpha_pict[(int)((1 - img->dim) * MAX_ALPHA)];
+		xcb_render_composite(base->c, XCB_RENDER_PICT_OP_SRC, src, alpha_pict,
+		                     xd->render_pict, 0, 0, 0, 0, x, y, w, h);
+	} else {
+		// Remove the part of the background covered by the image, then add the
+		// dimmed color of the image on top of it.
+		auto alpha_pict = xd->alpha_pict[(int)(img->opacity * MAX_ALPHA)];
+		auto dim_alpha_pict =
+		    xd->alpha_pict[(int)(img->opacity * (1 - img->dim) * MAX_ALPHA)];
+		xcb_render_composite(base->c, XCB_RENDER_PICT_OP_OUT_REVERSE, src,
+		                     alpha_pict, xd->render_pict, 0, 0, 0, 0, x, y, w, h);
+		xcb_render_composite(base->c, XCB_RENDER_PICT_OP_ADD, src, dim_alpha_pict,
+		                     xd->render_pict, 0, 0, 0, 0, x, y, w, h);
+	}
 
-	x_set_picture_clip_region(base->c, xd->back[2], 0, 0, &reg);
-	xcb_render_composite(base->c, op, img->pict, alpha_pict, xd->back[2], 0, 0, 0, 0,
-	                     to_i16_checked(dst_x), to_i16_checked(dst_y),
-	                     to_u16_checked(img->ewidth), to_u16_checked(img->eheight));
+	if (tile != XCB_NONE) {
+		xcb_render_free_picture(base->c, tile);
+	} else if (tiled) {
+		xcb_render_change_picture(base->c, src, XCB_RENDER_CP_REPEAT,
+		                          (uint32_t[]){XCB_RENDER_REPEAT_NONE});
+	}
+	if (inverted) {
+		pixmap_pool_put(xd, inverted);
+	}
 	pixman_region32_fini(&reg);
 }
 
+static void compose_batch(backend_t *base, const struct backend_compose_item *items,
+                          int count, const region_t *reg_visible) {
+	for (int i = 0; i < count; i++) {
+		// Opacity and size are applied lazily, a shallow copy is enough
+		struct _xrender_image_data img = *(struct _xrender_image_data *)items[i].image;
+		img.opacity *= items[i].opacity;
+		img.ewidth = items[i].width;
+		img.eheight = items[i].height;
+		compose(base, &img, items[i].dst_x, items[i].dst_y, &items[i].reg_paint,
+		        reg_visible);
+	}
+}
+
 static void fill(backend_t *base, struct color c, const region_t *clip) {
 	struct _xrender_data *xd = (void *)base;
 	const rect_t *extent = pixman_region32_extents((region_t *)clip);
-	x_set_picture_clip_region(base->c, xd->back[2], 0, 0, clip);
+	x_set_picture_clip_region(base->c, xd->render_pict, 0, 0, clip);
 	// color is in X fixed point representation
 	xcb_render_fill_rectangles(
-	    base->c, XCB_RENDER_PICT_OP_OVER, xd->back[2],
+	    base->c, XCB_RENDER_PICT_OP_OVER, xd->render_pict,
 	    (xcb_render_color_t){.red = (uint16_t)(c.red * 0xffff),
 	                         .green = (uint16_t)(c.green * 0xffff),
 	                         .blue = (uint16_t)(c.blue * 0xffff),
@@ -84,43 +293,81 @@ bind_pixmap(backend_t *base, xcb_pixmap_t pixmap, struct xvisual_info fmt, bool
 		return NULL;
 	}
 
-	auto img = ccalloc(1, struct _xrender_image_data);
-	img->depth = (uint8_t)fmt.visual_depth;
-	img->width = img->ewidth = r->width;
-	img->height = img->eheight = r->height;
-	img->pixmap = pixmap;
-	img->opacity = 1;
-	img->has_alpha = fmt.alpha_size != 0;
-	img->pict =
+	auto inner = ccalloc(1, struct _xrender_image_data_inner);
+	inner->depth = (uint8_t)fmt.visual_depth;
+	inner->width = r->width;
+	inner->height = r->height;
+	inner->pixmap = pixmap;
+	inner->pict =
 	    x_create_picture_with_visual_and_pixmap(base->c, fmt.visual, pixmap, 0, NULL);
-	img->owned = owned;
-	img->visual = fmt.visual;
-	if (img->pict == XCB_NONE) {
-		free(img);
+	inner->owned = owned;
+	inner->visual = fmt.visual;
+	inner->refcount = 1;
+	free(r);
+	if (inner->pict == XCB_NONE) {
+		free(inner);
 		return NULL;
 	}
+
+	auto img = ccalloc(1, struct _xrender_image_data);
+	img->inner = inner;
+	img->ewidth = inner->width;
+	img->eheight = inner->height;
+	img->opacity = 1;
+	img->has_alpha = fmt.alpha_size != 0;
 	return img;
 }
 
+static void release_image_inner(backend_t *base, struct _xrender_image_data_inner *inner) {
+	inner->refcount--;
+	assert(inner->refcount >= 0);
+	if (inner->refcount > 0) {
+		return;
+	}
+	if (inner->pooled) {
+		pixmap_pool_put((void *)base, inner->pooled);
+		free(inner);
+		return;
+	}
+	xcb_render_free_picture(base->c, inner->pict);
+	if (inner->owned) {
+		xcb_free_pixmap(base->c, inner->pixmap);
+	}
+	free(inner);
+}
+
 static void release_image(backend_t *base, void *image) {
 	struct _xrender_image_data *img = image;
-	xcb_render_free_picture(base->c, img->pict);
-	if (img->owned) {
-		xcb_free_pixmap(base->c, img->pixmap);
-	}
+	release_image_inner(base, img->inner);
 	free(img);
 }
 
 static void deinit(backend_t *backend_data) {
 	struct _xrender_data *xd = (void *)backend_data;
+	ev_timer_stop(xd->base.loop, &xd->pixmap_pool_timer);
+	log_debug("xrender: offscreen pixmap pool: %" PRIu64 " hits, %" PRIu64 " misses",
+	          xd->pixmap_pool_hits, xd->pixmap_pool_misses);
+	list_foreach_safe(struct xrender_pooled_pixmap, i, &xd->pixmap_pool, siblings) {
+		pixmap_pool_free_entry(xd, i);
+	}
 	for (int i = 0; i < 256; i++) {
 		xcb_render_free_picture(xd->base.c, xd->alpha_pict[i]);
 	}
 	xcb_render_free_picture(xd->base.c, xd->target);
 	xcb_render_free_picture(xd->base.c, xd->root_pict);
-	for (int i = 0; i < 2; i++) {
-		xcb_render_free_picture(xd->base.c, xd->back[i]);
-		xcb_free_pixmap(xd->base.c, xd->back_pixmap[i]);
+	if (xd->render_pict != XCB_NONE) {
+		xcb_render_free_picture(xd->base.c, xd->render_pict);
+	}
+	if (xd->render_pixmap != XCB_NONE) {
+		xcb_free_pixmap(xd->base.c, xd->render_pixmap);
+	}
+	for (int i = 0; i < xd->nbuffers; i++) {
+		if (xd->back[i] != XCB_NONE) {
+			xcb_render_free_picture(xd->base.c, xd->back[i]);
+		}
+		if (xd->back_pixmap[i] != XCB_NONE) {
+			xcb_free_pixmap(xd->base.c, xd->back_pixmap[i]);
+		}
 	}
 	if (xd->present_event) {
 		xcb_unregister_for_special_event(xd->base.c, xd->present_event);
@@ -130,6 +377,23 @@ static void deinit(backend_t *backend_data) {
 	free(xd);
 }
 
+/// Pick the next idle back buffer to render into, starting from the one after
+/// `curr_back`. Returns false if all back buffers are still in use.
+static bool pick_next_buffer(struct _xrender_data *xd) {
+	for (int i = 1; i <= xd->nbuffers; i++) {
+		int next = (xd->curr_back + i) % xd->nbuffers;
+		if (!xd->buffer_in_use[next]) {
+			xd->curr_back = next;
+			return true;
+		}
+	}
+	return false;
+}
+
+static inline void update_busy(struct _xrender_data *xd) {
+	xd->base.busy = xd->present_in_flight || xd->waiting_for_buffer;
+}
+
 static void present(backend_t *base, const region_t *region) {
 	struct _xrender_data *xd = (void *)base;
 	const rect_t *extent = pixman_region32_extents((region_t *)region);
@@ -137,59 +401,107 @@ static void present(backend_t *base, const region_t *region) {
 	uint16_t region_width = to_u16_checked(extent->x2 - extent->x1),
 	         region_height = to_u16_checked(extent->y2 - extent->y1);
 
-	// compose() sets clip region on the back buffer, so clear it first
-	x_clear_picture_clip_region(base->c, xd->back[xd->curr_back]);
-
 	// limit the region of update
-	x_set_picture_clip_region(base->c, xd->back[2], 0, 0, region);
+	x_set_picture_clip_region(base->c, xd->render_pict, 0, 0, region);
 
 	if (xd->vsync) {
+		assert(!base->busy);
+		// compose() sets clip region on the back buffer, so clear it first
+		x_clear_picture_clip_region(base->c, xd->back[xd->curr_back]);
+
 		// Update the back buffer first, then present
-		xcb_render_composite(base->c, XCB_RENDER_PICT_OP_SRC, xd->back[2],
+		xcb_render_composite(base->c, XCB_RENDER_PICT_OP_SRC, xd->render_pict,
 		                     XCB_NONE, xd->back[xd->curr_back], orig_x, orig_y, 0,
 		                     0, orig_x, orig_y, region_width, region_height);
 
-		// Make sure we got reply from PresentPixmap before waiting for events,
-		// to avoid deadlock
-		auto e = xcb_request_check(
-		    base->c, xcb_present_pixmap_checked(
-		                 xd->base.c, xd->target_win,
-		                 xd->back_pixmap[xd->curr_back], 0, XCB_NONE, XCB_NONE, 0,
-		                 0, XCB_NONE, XCB_NONE, XCB_NONE, 0, 0, 0, 0, 0, NULL));
-		if (e) {
-			log_error("Failed to present pixmap");
-			free(e);
-			return;
-		}
-		// TODO don't block wait for present completion
-		xcb_present_generic_event_t *pev =
-		    (void *)xcb_wait_for_special_event(base->c, xd->present_event);
-		if (!pev) {
-			// We don't know what happened, maybe X died
-			// But reset buffer age, so in case we do recover, we will
-			// render correctly.
-			xd->buffer_age[0] = xd->buffer_age[1] = -1;
-			return;
-		}
-		assert(pev->evtype == XCB_PRESENT_COMPLETE_NOTIFY);
-		xcb_present_complete_notify_event_t *pcev = (void *)pev;
-		// log_trace("Present complete: %d %ld", pcev->mode, pcev->msc);
-		xd->buffer_age[xd->curr_back] = 1;
+		// Don't wait for the completion here, handle_events() will pick up
+		// the PresentCompleteNotify from the event loop, and the backend stays
+		// busy until then.
+		xd->present_serial++;
+		xcb_present_pixmap(xd->base.c, xd->target_win,
+		                   xd->back_pixmap[xd->curr_back], xd->present_serial,
+		                   XCB_NONE, XCB_NONE, 0, 0, XCB_NONE, XCB_NONE, XCB_NONE,
+		                   0, 0, 0, 0, 0, NULL);
+		xd->buffer_in_use[xd->curr_back] = true;
+		xd->present_in_flight = true;
+		update_busy(xd);
+	} else {
+		// No vsync needed, draw into the target picture directly
+		xcb_render_composite(base->c, XCB_RENDER_PICT_OP_SRC, xd->render_pict,
+		                     XCB_NONE, xd->target, orig_x, orig_y, 0, 0, orig_x,
+		                     orig_y, region_width, region_height);
+	}
+}
 
+/// Handle a PresentCompleteNotify for the frame currently in flight
+static void present_complete(struct _xrender_data *xd,
+                             const xcb_present_complete_notify_event_t *pcev) {
+	if (!xd->present_in_flight || pcev->serial != xd->present_serial) {
+		// Stale event, e.g. from before a backend reset
+		return;
+	}
+	// log_trace("Present complete: %d %ld", pcev->mode, pcev->msc);
+	for (int i = 0; i < xd->nbuffers; i++) {
 		// buffer_age < 0 means that back buffer is empty
-		if (xd->buffer_age[1 - xd->curr_back] > 0) {
-			xd->buffer_age[1 - xd->curr_back]++;
+		if (i != xd->curr_back && xd->buffer_age[i] > 0) {
+			xd->buffer_age[i]++;
+		}
+	}
+	xd->buffer_age[xd->curr_back] = 1;
+
+	if (pcev->mode == XCB_PRESENT_COMPLETE_MODE_FLIP) {
+		// We cannot use the pixmap we used anymore, it's being scanned out.
+		// Move on to the next idle buffer, if there is one.
+		xd->waiting_for_buffer = !pick_next_buffer(xd);
+	} else {
+		// The content has been copied, the pixmap is ours again
+		xd->buffer_in_use[xd->curr_back] = false;
+	}
+	xd->present_in_flight = false;
+	update_busy(xd);
+}
+
+/// Handle a PresentIdleNotify, the X server no longer uses `pixmap`
+static void present_idle(struct _xrender_data *xd, xcb_pixmap_t pixmap) {
+	for (int i = 0; i < xd->nbuffers; i++) {
+		if (xd->back_pixmap[i] == pixmap) {
+			xd->buffer_in_use[i] = false;
+			break;
 		}
-		if (pcev->mode == XCB_PRESENT_COMPLETE_MODE_FLIP) {
-			// We cannot use the pixmap we used anymore
-			xd->curr_back = 1 - xd->curr_back;
+	}
+	if (xd->waiting_for_buffer && pick_next_buffer(xd)) {
+		xd->waiting_for_buffer = false;
+		update_busy(xd);
+	}
+}
+
+static void handle_events(backend_t *base) {
+	struct _xrender_data *xd = (void *)base;
+	if (!xd->present_event) {
+		return;
+	}
+
+	xcb_present_generic_event_t *pev;
+	while ((pev = (void *)xcb_poll_for_special_event(base->c, xd->present_event))) {
+		if (pev->evtype == XCB_PRESENT_COMPLETE_NOTIFY) {
+			present_complete(xd, (void *)pev);
+		} else if (pev->evtype == XCB_PRESENT_IDLE_NOTIFY) {
+			present_idle(xd, ((xcb_present_idle_notify_event_t *)pev)->pixmap);
 		}
 		free(pev);
-	} else {
-		// No vsync needed, draw into the target picture directly
-		xcb_render_composite(base->c, XCB_RENDER_PICT_OP_SRC, xd->back[2],
-		                     XCB_NONE, xd->target, orig_x, orig_y, 0, 0, orig_x,
-		                     orig_y, region_width, region_height);
+	}
+
+	if (base->busy && xcb_connection_has_error(base->c)) {
+		// We don't know what happened, maybe X died
+		// But reset buffer age, so in case we do recover, we will
+		// render correctly.
+		for (int i = 0; i < xd->nbuffers; i++) {
+			xd->buffer_age[i] = -1;
+			xd->buffer_in_use[i] = false;
+		}
+		xd->present_in_flight = false;
+		xd->waiting_for_buffer = false;
+		update_busy(xd);
 	}
 }
 
@@ -208,6 +520,47 @@ static bool is_image_transparent(backend_t *bd attr_unused, void *image) {
 	return img->has_alpha;
 }
 
+/// Make sure `img` has its own pixmap, so it can be modified in place. Pending color
+/// inversion is applied to the new pixmap, because it doesn't commute with the
+/// region-restricted operations. Opacity and dimming stay lazy.
+static bool decouple_image(backend_t *base, struct _xrender_image_data *img) {
+	struct _xrender_data *xd = (void *)base;
+	auto inner = img->inner;
+	if (inner->refcount == 1 && inner->owned && !img->color_inverted) {
+		return true;
+	}
+
+	log_trace("xrender: copying %#010x visual %#x", inner->pixmap, inner->visual);
+	assert(inner->visual != XCB_NONE);
+	auto pooled =
+	    pixmap_pool_get(xd, inner->depth, inner->visual, inner->width, inner->height);
+	if (!pooled) {
+		return false;
+	}
+	auto new_inner = ccalloc(1, struct _xrender_image_data_inner);
+	*new_inner = *inner;
+	new_inner->refcount = 1;
+	new_inner->owned = true;
+	new_inner->pooled = pooled;
+	new_inner->pixmap = pooled->pixmap;
+	new_inner->pict = pooled->pict;
+
+	if (img->color_inverted) {
+		render_inverted(xd, inner, img->has_alpha, new_inner->pict);
+	} else {
+		x_clear_picture_clip_region(base->c, inner->pict);
+		xcb_render_composite(base->c, XCB_RENDER_PICT_OP_SRC, inner->pict, XCB_NONE,
+		                     new_inner->pict, 0, 0, 0, 0, 0, 0,
+		                     to_u16_checked(inner->width),
+		                     to_u16_checked(inner->height));
+	}
+
+	release_image_inner(base, inner);
+	img->inner = new_inner;
+	img->color_inverted = false;
+	return true;
+}
+
 static bool image_op(backend_t *base, enum image_operations op, void *image,
                      const region_t *reg_op, const region_t *reg_visible, void *arg) {
 	struct _xrender_data *xd = (void *)base;
@@ -215,56 +568,16 @@ static bool image_op(backend_t *base, enum image_operations op, void *image,
 	region_t reg;
 	double *dargs = arg;
 	int *iargs = arg;
-	if (op == IMAGE_OP_APPLY_ALPHA_ALL) {
-		img->opacity *= dargs[0];
-		img->has_alpha = true;
-		return true;
-	}
+	bool ret = true;
 
 	pixman_region32_init(&reg);
-
-	const auto tmpw = to_u16_checked(img->width);
-	const auto tmph = to_u16_checked(img->height);
 	switch (op) {
-	case IMAGE_OP_INVERT_COLOR_ALL:
-		x_set_picture_clip_region(base->c, img->pict, 0, 0, reg_visible);
-		if (img->has_alpha) {
-			auto tmp_pict =
-			    x_create_picture_with_visual(base->c, base->root, img->width,
-			                                 img->height, img->visual, 0, NULL);
-			xcb_render_composite(base->c, XCB_RENDER_PICT_OP_SRC, img->pict,
-			                     XCB_NONE, tmp_pict, 0, 0, 0, 0, 0, 0, tmpw, tmph);
-
-			xcb_render_composite(base->c, XCB_RENDER_PICT_OP_DIFFERENCE,
-			                     xd->white_pixel, XCB_NONE, img->pict, 0, 0,
-			                     0, 0, 0, 0, tmpw, tmph);
-			xcb_render_composite(base->c, XCB_RENDER_PICT_OP_IN_REVERSE,
-			                     tmp_pict, XCB_NONE, img->pict, 0, 0, 0, 0, 0,
-			                     0, tmpw, tmph);
-			xcb_render_free_picture(base->c, tmp_pict);
-		} else {
-			xcb_render_composite(base->c, XCB_RENDER_PICT_OP_DIFFERENCE,
-			                     xd->white_pixel, XCB_NONE, img->pict, 0, 0,
-			                     0, 0, 0, 0, tmpw, tmph);
-		}
-		break;
-	case IMAGE_OP_DIM_ALL:
-		x_set_picture_clip_region(base->c, img->pict, 0, 0, reg_visible);
-
-		xcb_render_color_t color = {
-		    .red = 0, .green = 0, .blue = 0, .alpha = (uint16_t)(0xffff * dargs[0])};
-
-		// Dim the actually content of window
-		xcb_rectangle_t rect = {
-		    .x = 0,
-		    .y = 0,
-		    .width = tmpw,
-		    .height = tmph,
-		};
-
-		xcb_render_fill_rectangles(base->c, XCB_RENDER_PICT_OP_OVER, img->pict,
-		                           color, 1, &rect);
+	case IMAGE_OP_APPLY_ALPHA_ALL:
+		img->opacity *= dargs[0];
+		img->has_alpha = true;
 		break;
+	case IMAGE_OP_INVERT_COLOR_ALL: img->color_inverted = true; break;
+	case IMAGE_OP_DIM_ALL: img->dim = 1.0 - (1.0 - img->dim) * (1.0 - dargs[0]); break;
 	case IMAGE_OP_APPLY_ALPHA:
 		assert(reg_op);
 		pixman_region32_intersect(&reg, (region_t *)reg_op, (region_t *)reg_visible);
@@ -276,61 +589,44 @@ static bool image_op(backend_t *base, enum image_operations op, void *image,
 			break;
 		}
 
+		if (!decouple_image(base, img)) {
+			ret = false;
+			break;
+		}
+
 		auto alpha_pict = xd->alpha_pict[(int)((1 - dargs[0]) * MAX_ALPHA)];
-		x_set_picture_clip_region(base->c, img->pict, 0, 0, &reg);
+		x_set_picture_clip_region(base->c, img->inner->pict, 0, 0, &reg);
 		xcb_render_composite(base->c, XCB_RENDER_PICT_OP_OUT_REVERSE, alpha_pict,
-		                     XCB_NONE, img->pict, 0, 0, 0, 0, 0, 0, tmpw, tmph);
+		                     XCB_NONE, img->inner->pict, 0, 0, 0, 0, 0, 0,
+		                     to_u16_checked(img->inner->width),
+		                     to_u16_checked(img->inner->height));
 		img->has_alpha = true;
 		break;
 	case IMAGE_OP_RESIZE_TILE:
 		img->ewidth = iargs[0];
 		img->eheight = iargs[1];
 		break;
-	case IMAGE_OP_APPLY_ALPHA_ALL: assert(false);
 	case IMAGE_OP_MAX_BRIGHTNESS: assert(false);
 	}
 	pixman_region32_fini(&reg);
-	return true;
+	return ret;
 }
 
-// TODO: use copy-on-write
-static void *copy(backend_t *base, const void *image, const region_t *reg) {
+static void *copy(backend_t *base attr_unused, const void *image,
+                  const region_t *reg attr_unused) {
 	const struct _xrender_image_data *img = image;
-	struct _xrender_data *xd = (void *)base;
 	auto new_img = ccalloc(1, struct _xrender_image_data);
-	assert(img->visual != XCB_NONE);
-	log_trace("xrender: copying %#010x visual %#x", img->pixmap, img->visual);
 	*new_img = *img;
-	x_set_picture_clip_region(base->c, img->pict, 0, 0, reg);
-	new_img->pixmap =
-	    x_create_pixmap(base->c, img->depth, base->root, img->width, img->height);
-	new_img->opacity = 1;
-	new_img->owned = true;
-	if (new_img->pixmap == XCB_NONE) {
-		log_error("Failed to create pixmap for copy");
-		free(new_img);
-		return NULL;
-	}
-	new_img->pict = x_create_picture_with_visual_and_pixmap(base->c, img->visual,
-	                                                        new_img->pixmap, 0, NULL);
-	if (new_img->pict == XCB_NONE) {
-		log_error("Failed to create picture for copy");
-		xcb_free_pixmap(base->c, new_img->pixmap);
-		free(new_img);
-		return NULL;
-	}
-
-	xcb_render_picture_t alpha_pict =
-	    img->opacity == 1 ? XCB_NONE : xd->alpha_pict[(int)(img->opacity * MAX_ALPHA)];
-	xcb_render_composite(base->c, XCB_RENDER_PICT_OP_SRC, img->pict, alpha_pict,
-	                     new_img->pict, 0, 0, 0, 0, 0, 0, to_u16_checked(img->width),
-	                     to_u16_checked(img->height));
+	new_img->inner->refcount++;
 	return new_img;
 }
 
 backend_t *backend_xrender_init(session_t *ps) {
 	auto xd = ccalloc(1, struct _xrender_data);
 	init_backend_base(&xd->base, ps);
+	list_init_head(&xd->pixmap_pool);
+	ev_init(&xd->pixmap_pool_timer, pixmap_pool_timer_callback);
+	xd->pixmap_pool_timer.repeat = XRENDER_POOL_IDLE_TIMEOUT;
 
 	for (int i = 0; i <= MAX_ALPHA; ++i) {
 		double o = (double)i / (double)MAX_ALPHA;
@@ -363,7 +659,8 @@ backend_t *backend_xrender_init(session_t *ps) {
 		auto e =
 		    xcb_request_check(ps->c, xcb_present_select_input_checked(
 		                                 ps->c, eid, xd->target_win,
-		                                 XCB_PRESENT_EVENT_MASK_COMPLETE_NOTIFY));
+		                                 XCB_PRESENT_EVENT_MASK_COMPLETE_NOTIFY |
+		                                     XCB_PRESENT_EVENT_MASK_IDLE_NOTIFY));
 		if (e) {
 			log_error("Cannot select present input, vsync will be disabled");
 			xd->vsync = false;
@@ -380,11 +677,22 @@ backend_t *backend_xrender_init(session_t *ps) {
 	} else {
 		xd->vsync = false;
 	}
+	xd->base.paced = xd->vsync;
+
+	xd->render_pixmap = x_create_pixmap(ps->c, pictfmt->depth, ps->root,
+	                                    to_u16_checked(ps->root_width),
+	                                    to_u16_checked(ps->root_height));
+	xd->render_pict = x_create_picture_with_pictfmt_and_pixmap(
+	    ps->c, pictfmt, xd->render_pixmap, 0, NULL);
+	if (xd->render_pixmap == XCB_NONE || xd->render_pict == XCB_NONE) {
+		log_error("Cannot create pixmap for rendering");
+		goto err;
+	}
 
-	// We might need to do double buffering for vsync, and buffer 0 and 1 are for
-	// double buffering.
-	int first_buffer_index = xd->vsync ? 0 : 2;
-	for (int i = first_buffer_index; i < 3; i++) {
+	// Back buffers are only needed if we present with vsync
+	xd->nbuffers = xd->vsync ? ps->o.xrender_buffers : 0;
+	assert(xd->nbuffers <= XRENDER_MAX_BUFFERS);
+	for (int i = 0; i < xd->nbuffers; i++) {
 		xd->back_pixmap[i] = x_create_pixmap(ps->c, pictfmt->depth, ps->root,
 		                                     to_u16_checked(ps->root_width),
 		                                     to_u16_checked(ps->root_height));
@@ -416,6 +724,7 @@ struct backend_operations xrender_ops = {
     .deinit = deinit,
     .present = present,
     .compose = compose,
+    .compose_batch = compose_batch,
     .fill = fill,
     .bind_pixmap = bind_pixmap,
     .release_image = release_image,
@@ -424,7 +733,8 @@ struct backend_operations xrender_ops = {
     //.release_win = release_win,
     .is_image_transparent = is_image_transparent,
     .buffer_age = buffer_age,
-    .max_buffer_age = 2,
+    .max_buffer_age = XRENDER_MAX_BUFFERS,
+    .handle_events = handle_events,
 
     .image_op = image_op,
     .copy = copy,
@@ -1,4 +1,5 @@
 #pragma once
+#include <ev.h>
 #include <xcb/composite.h>
 #include <xcb/present.h>
 #include <xcb/render.h>
@@ -6,6 +7,28 @@
 #include <xcb/xcb.h>
 
 #include "backend/backend.h"
+#include "utils/list.h"
+
+/// Maximum number of back buffers in the swap chain
+#define XRENDER_MAX_BUFFERS 4
+
+/// Maximum number of idle pixmaps kept in the offscreen pixmap pool
+#define XRENDER_POOL_MAX_IDLE 32
+/// Idle pixmaps unused for longer than this are freed, in seconds
+#define XRENDER_POOL_IDLE_TIMEOUT 5.0
+
+/// An offscreen pixmap, and a picture for it, that can be recycled
+struct xrender_pooled_pixmap {
+	struct list_node siblings;
+	xcb_pixmap_t pixmap;
+	xcb_render_picture_t pict;
+	xcb_visualid_t visual;
+	uint8_t depth;
+	/// Size of the pixmap, rounded up to the size class
+	int width, height;
+	/// When this pixmap was returned to the pool
+	ev_tstamp last_used;
+};
 
 typedef struct _xrender_data {
 	backend_t base;
@@ -16,15 +39,27 @@ typedef struct _xrender_data {
 	xcb_window_t target_win;
 	/// Painting target, it is either the root or the overlay
 	xcb_render_picture_t target;
-	/// Back buffers. Double buffer, with 1 for temporary render use
-	xcb_render_picture_t back[3];
-	/// The back buffer that is for temporary use
+	/// Buffer for temporary render use, the scene is composed here before it is
+	/// copied into a back buffer (or directly onto the target without vsync)
+	xcb_render_picture_t render_pict;
+	/// The corresponding pixmap to the render buffer
+	xcb_pixmap_t render_pixmap;
+	/// Back buffers of the swap chain, only used with vsync.
+	xcb_render_picture_t back[XRENDER_MAX_BUFFERS];
+	/// The corresponding pixmap to the back buffer
+	xcb_pixmap_t back_pixmap[XRENDER_MAX_BUFFERS];
 	/// Age of each back buffer.
-	int buffer_age[3];
+	int buffer_age[XRENDER_MAX_BUFFERS];
+	/// Whether each back buffer has been presented and is not yet idle, i.e. the X
+	/// server might still read from it
+	bool buffer_in_use[XRENDER_MAX_BUFFERS];
+	/// Number of back buffers in the swap chain
+	int nbuffers;
 	/// The back buffer we should be painting into
 	int curr_back;
-	/// The corresponding pixmap to the back buffer
-	xcb_pixmap_t back_pixmap[3];
+	/// Whether all back buffers are in use, and we are waiting for one of them to
+	/// become idle
+	bool waiting_for_buffer;
 	/// The original root window content, usually the wallpaper.
 	/// We save it so we don't loss the wallpaper when we paint over
 	/// it.
@@ -44,4 +79,19 @@ typedef struct _xrender_data {
 	int target_width, target_height;
 
 	xcb_special_event_t *present_event;
+	/// Serial of the last PresentPixmap request we sent
+	uint32_t present_serial;
+	/// Whether we are still waiting for the PresentCompleteNotify of the last
+	/// PresentPixmap request. Rendering into the back buffers is not allowed until
+	/// then.
+	bool present_in_flight;
+
+	/// Idle offscreen pixmaps, most recently used first
+	struct list_node pixmap_pool;
+	int pixmap_pool_len;
+	/// Number of offscreen pixmap requests served from the pool, and the number
+	/// of those that needed a new pixmap
+	uint64_t pixmap_pool_hits, pixmap_pool_misses;
+	/// Timer to free pixmaps that have been idle for too long
+	ev_timer pixmap_pool_timer;
 } xrender_data;
@@ -15,21 +15,15 @@
 #include <stdio.h>
 #include <string.h>
 
-// libpcre
+// libpcre2
 #ifdef CONFIG_REGEX_PCRE
-#include <pcre.h>
-
-// For compatibility with <libpcre-8.20
-#ifndef PCRE_STUDY_JIT_COMPILE
-#define PCRE_STUDY_JIT_COMPILE 0
-#define LPCRE_FREE_STUDY(extra) pcre_free(extra)
-#else
-#define LPCRE_FREE_STUDY(extra) pcre_free_study(extra)
-#endif
-
+#define PCRE2_CODE_UNIT_WIDTH 8
+#include <pcre2.h>
 #endif
 
 #include <X11/Xlib.h>
+#include <test.h>
+#include <uthash.h>
 #include <xcb/xcb.h>
 
 #include "utils/compiler.h"
@@ -40,6 +34,7 @@
 #include "common.h"
 #include "config.h"
 #include "log.h"
+#include "prop_cache.h"
 #include "win.h"
 #include "x.h"
 
@@ -104,6 +99,9 @@ struct _c2_l {
 	       C2_L_MPCRE,
 	} match : 3;
 	bool match_ignorecase : 1;
+	/// Whether the wildcard pattern only has `*` in it, and can be matched with
+	/// c2h_glob_match instead of fnmatch
+	bool match_simple_glob : 1;
 	char *tgt;
 	xcb_atom_t tgtatom;
 	bool tgt_onframe;
@@ -148,10 +146,17 @@ struct _c2_l {
 	       C2_L_PTINT,
 	} ptntype;
 	char *ptnstr;
+	/// ptnstr with ASCII letters folded to lower case, for case insensitive
+	/// patterns
+	char *ptnstr_folded;
+	/// Hash of ptnstr, or of ptnstr_folded for case insensitive patterns
+	uint32_t ptnstr_hash;
 	long ptnint;
 #ifdef CONFIG_REGEX_PCRE
-	pcre *regex_pcre;
-	pcre_extra *regex_pcre_extra;
+	pcre2_code *regex_pcre;
+	/// Match data of the pattern, reused by every match. Matching only happens on
+	/// the main thread.
+	pcre2_match_data *regex_pcre_match;
 #endif
 };
 
@@ -159,57 +164,131 @@ struct _c2_l {
 #define C2_L_INIT                                                                           \
 	{                                                                                   \
 		.neg = false, .op = C2_L_OEXISTS, .match = C2_L_MEXACT,                     \
-		.match_ignorecase = false, .tgt = NULL, .tgtatom = 0, .tgt_onframe = false, \
+		.match_ignorecase = false, .match_simple_glob = false, .tgt = NULL,         \
+		.tgtatom = 0, .tgt_onframe = false,                                         \
 		.predef = C2_L_PUNDEFINED, .index = -1, .type = C2_L_TUNDEFINED,            \
 		.format = 0, .ptntype = C2_L_PTUNDEFINED, .ptnstr = NULL, .ptnint = 0,      \
 	}
 
 static const c2_l_t leaf_def = C2_L_INIT;
 
+/// Instructions of a compiled condition list.
+///
+/// Programs have a single boolean register, and a stack for the operands of XOR.
+typedef enum {
+	/// Set the register to the result of matching a leaf, `leaf` can be NULL
+	C2_OP_LEAF,
+	/// Jump to `target` if the register is false
+	C2_OP_JUMP_IF_FALSE,
+	/// Jump to `target` if the register is true
+	C2_OP_JUMP_IF_TRUE,
+	/// Push the register on the stack
+	C2_OP_PUSH,
+	/// Set the register to (popped value != register)
+	C2_OP_XOR,
+	/// Negate the register
+	C2_OP_NOT,
+	/// Stop with condition number `rule` matched if the register is true
+	C2_OP_MATCH,
+} c2_opcode_t;
+
+typedef struct {
+	c2_opcode_t op;
+	union {
+		const c2_l_t *leaf;
+		int target;
+		int rule;
+	};
+} c2_insn_t;
+
+/// Maximum depth of the stack of a program. Condition lists nesting XORs deeper than
+/// this are not compiled.
+#define C2_PROGRAM_MAX_STACK 32
+
+/// Conditions of a list that require a predefined target to be equal to a value,
+/// see c2_index_build
+struct c2_index_entry {
+	/// The value, for string targets
+	const char *str;
+	/// The value, for integer targets
+	long num;
+	/// Numbers of the conditions, in ascending order
+	int *rules;
+	int nrules;
+	int capacity;
+	UT_hash_handle hh;
+};
+
+/// A condition list compiled into a flat program, see c2_compile
+typedef struct {
+	c2_insn_t *insns;
+	int ninsns;
+	/// Data of the conditions, indexed by condition number
+	void **data;
+	int nrules;
+	/// Where the code of each condition starts, plus the end of the program
+	int *rule_start;
+	/// Conditions indexed by the value a predefined target has to be equal to, for
+	/// each target. NULL if no condition was indexed, see c2_index_build.
+	struct c2_index_entry **index;
+	/// Numbers of the conditions not in the index, in ascending order
+	int *unindexed;
+	int nunindexed;
+} c2_program_t;
+
 /// Linked list type of conditions.
 struct _c2_lptr {
 	c2_ptr_t ptr;
 	void *data;
 	struct _c2_lptr *next;
+	/// The list starting at this element, compiled. Set by c2_list_postprocess.
+	c2_program_t *program;
+	/// What the list starting at this element depends on. Set by
+	/// c2_list_postprocess.
+	unsigned int deps;
 };
 
 /// Initializer for c2_lptr_t.
 #define C2_LPTR_INIT                                                                     \
-	{ .ptr = C2_PTR_INIT, .data = NULL, .next = NULL, }
+	{ .ptr = C2_PTR_INIT, .data = NULL, .next = NULL, .program = NULL,              \
+	  .deps = C2_DEP_ALL, }
 
 /// Structure representing a predefined target.
 typedef struct {
 	const char *name;
 	enum c2_l_type type;
 	int format;
+	/// What the target depends on, a mask of enum c2_dep
+	unsigned int deps;
 } c2_predef_t;
 
 // Predefined targets.
 static const c2_predef_t C2_PREDEFS[] = {
-    [C2_L_PID] = {"id", C2_L_TCARDINAL, 0},
-    [C2_L_PX] = {"x", C2_L_TCARDINAL, 0},
-    [C2_L_PY] = {"y", C2_L_TCARDINAL, 0},
-    [C2_L_PX2] = {"x2", C2_L_TCARDINAL, 0},
-    [C2_L_PY2] = {"y2", C2_L_TCARDINAL, 0},
-    [C2_L_PWIDTH] = {"width", C2_L_TCARDINAL, 0},
-    [C2_L_PHEIGHT] = {"height", C2_L_TCARDINAL, 0},
-    [C2_L_PWIDTHB] = {"widthb", C2_L_TCARDINAL, 0},
-    [C2_L_PHEIGHTB] = {"heightb", C2_L_TCARDINAL, 0},
-    [C2_L_PBDW] = {"border_width", C2_L_TCARDINAL, 0},
-    [C2_L_PFULLSCREEN] = {"fullscreen", C2_L_TCARDINAL, 0},
-    [C2_L_POVREDIR] = {"override_redirect", C2_L_TCARDINAL, 0},
-    [C2_L_PARGB] = {"argb", C2_L_TCARDINAL, 0},
-    [C2_L_PFOCUSED] = {"focused", C2_L_TCARDINAL, 0},
-    [C2_L_PWMWIN] = {"wmwin", C2_L_TCARDINAL, 0},
-    [C2_L_PBSHAPED] = {"bounding_shaped", C2_L_TCARDINAL, 0},
-    [C2_L_PROUNDED] = {"rounded_corners", C2_L_TCARDINAL, 0},
-    [C2_L_PCLIENT] = {"client", C2_L_TWINDOW, 0},
-    [C2_L_PWINDOWTYPE] = {"window_type", C2_L_TSTRING, 0},
-    [C2_L_PLEADER] = {"leader", C2_L_TWINDOW, 0},
-    [C2_L_PNAME] = {"name", C2_L_TSTRING, 0},
-    [C2_L_PCLASSG] = {"class_g", C2_L_TSTRING, 0},
-    [C2_L_PCLASSI] = {"class_i", C2_L_TSTRING, 0},
-    [C2_L_PROLE] = {"role", C2_L_TSTRING, 0},
+    [C2_L_PID] = {"id", C2_L_TCARDINAL, 0, 0},
+    [C2_L_PX] = {"x", C2_L_TCARDINAL, 0, C2_DEP_GEOMETRY},
+    [C2_L_PY] = {"y", C2_L_TCARDINAL, 0, C2_DEP_GEOMETRY},
+    [C2_L_PX2] = {"x2", C2_L_TCARDINAL, 0, C2_DEP_GEOMETRY},
+    [C2_L_PY2] = {"y2", C2_L_TCARDINAL, 0, C2_DEP_GEOMETRY},
+    [C2_L_PWIDTH] = {"width", C2_L_TCARDINAL, 0, C2_DEP_GEOMETRY},
+    [C2_L_PHEIGHT] = {"height", C2_L_TCARDINAL, 0, C2_DEP_GEOMETRY},
+    [C2_L_PWIDTHB] = {"widthb", C2_L_TCARDINAL, 0, C2_DEP_GEOMETRY},
+    [C2_L_PHEIGHTB] = {"heightb", C2_L_TCARDINAL, 0, C2_DEP_GEOMETRY},
+    [C2_L_PBDW] = {"border_width", C2_L_TCARDINAL, 0, C2_DEP_GEOMETRY},
+    [C2_L_PFULLSCREEN] = {"fullscreen", C2_L_TCARDINAL, 0,
+                          C2_DEP_GEOMETRY | C2_DEP_OTHER | C2_DEP_PROPERTY},
+    [C2_L_POVREDIR] = {"override_redirect", C2_L_TCARDINAL, 0, C2_DEP_OTHER},
+    [C2_L_PARGB] = {"argb", C2_L_TCARDINAL, 0, C2_DEP_OTHER},
+    [C2_L_PFOCUSED] = {"focused", C2_L_TCARDINAL, 0, C2_DEP_FOCUS},
+    [C2_L_PWMWIN] = {"wmwin", C2_L_TCARDINAL, 0, C2_DEP_OTHER},
+    [C2_L_PBSHAPED] = {"bounding_shaped", C2_L_TCARDINAL, 0, C2_DEP_OTHER},
+    [C2_L_PROUNDED] = {"rounded_corners", C2_L_TCARDINAL, 0, C2_DEP_OTHER},
+    [C2_L_PCLIENT] = {"client", C2_L_TWINDOW, 0, C2_DEP_CLIENT},
+    [C2_L_PWINDOWTYPE] = {"window_type", C2_L_TSTRING, 0, C2_DEP_WINDOW_TYPE},
+    [C2_L_PLEADER] = {"leader", C2_L_TWINDOW, 0, C2_DEP_LEADER},
+    [C2_L_PNAME] = {"name", C2_L_TSTRING, 0, C2_DEP_NAME},
+    [C2_L_PCLASSG] = {"class_g", C2_L_TSTRING, 0, C2_DEP_CLASS},
+    [C2_L_PCLASSI] = {"class_i", C2_L_TSTRING, 0, C2_DEP_CLASS},
+    [C2_L_PROLE] = {"role", C2_L_TSTRING, 0, C2_DEP_ROLE},
 };
 
 /**
@@ -232,6 +311,33 @@ static inline long winprop_get_int(winprop_t prop) {
 	return tgt;
 }
 
+/**
+ * Get a property of `wid` to match `w` against.
+ *
+ * Properties are cached while `w` is mapped, since we then get told about their
+ * changes.
+ */
+static inline winprop_t c2_get_prop(session_t *ps, const struct managed_win *w,
+                                    xcb_window_t wid, xcb_atom_t atom, int offset,
+                                    int length, xcb_atom_t rtype, int rformat) {
+	if (w->a.map_state == XCB_MAP_STATE_VIEWABLE) {
+		return prop_cache_get(ps, wid, atom, offset, length, rtype, rformat);
+	}
+	return x_get_prop_with_offset(ps, wid, atom, offset, length, rtype, rformat);
+}
+
+/**
+ * Get a text property of `wid` to match `w` against. See c2_get_prop.
+ */
+static inline bool c2_get_text_prop(session_t *ps, const struct managed_win *w,
+                                    xcb_window_t wid, xcb_atom_t atom, char ***pstrlst,
+                                    int *pnstr) {
+	if (w->a.map_state == XCB_MAP_STATE_VIEWABLE) {
+		return prop_cache_get_text(ps, wid, atom, pstrlst, pnstr);
+	}
+	return wid_get_text_prop(ps, wid, atom, pstrlst, pnstr);
+}
+
 /**
  * Compare next word in a string with another string.
  */
@@ -266,7 +372,7 @@ static inline void c2_ptr_reset(c2_ptr_t *pp) {
  * Combine two condition trees.
  */
 static inline c2_ptr_t c2h_comb_tree(c2_b_op_t op, c2_ptr_t p1, c2_ptr_t p2) {
-	c2_ptr_t p = {.isbranch = true, .b = cmalloc(c2_b_t)};
+	c2_ptr_t p = {.isbranch = true, .b = ccalloc(1, c2_b_t)};
 
 	p.b->opr1 = p1;
 	p.b->opr2 = p2;
@@ -302,6 +408,63 @@ static inline int c2h_b_opcmp(c2_b_op_t op1, c2_b_op_t op2) {
 	return c2h_b_opp(op1) - c2h_b_opp(op2);
 }
 
+/**
+ * Check if a wildcard pattern can be matched with c2h_glob_match.
+ *
+ * It can if `*` is its only special character. When ignoring case, it also has to be
+ * ASCII, as fnmatch folds the case of other characters according to the locale.
+ */
+static bool c2h_is_simple_glob(const char *pattern, bool ignorecase) {
+	for (const char *pc = pattern; *pc; pc++) {
+		if (*pc == '?' || *pc == '[' || *pc == '\\' ||
+		    (ignorecase && (unsigned char)*pc >= 0x80)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Match a string against a wildcard pattern that only has `*` in it, like fnmatch
+ * would, without its overhead.
+ */
+static bool c2h_glob_match(const char *pattern, const char *str, bool ignorecase) {
+	int (*const cmp)(const char *, const char *, size_t) =
+	    ignorecase ? strncasecmp : strncmp;
+	const char *star = strchr(pattern, '*');
+	if (!star) {
+		return ignorecase ? !strcasecmp(pattern, str) : !strcmp(pattern, str);
+	}
+
+	// The parts before the first `*` and after the last one have to match the
+	// start and the end of the string
+	const size_t len = strlen(str);
+	const size_t prefix = (size_t)(star - pattern);
+	const char *last = strrchr(pattern, '*') + 1;
+	const size_t suffix = strlen(last);
+	if (prefix + suffix > len || cmp(pattern, str, prefix) ||
+	    cmp(last, str + len - suffix, suffix)) {
+		return false;
+	}
+
+	// The parts in between have to appear in order in what is left. Taking the
+	// first occurrence of each leaves the most room for the next ones.
+	const char *s = str + prefix, *const end = str + len - suffix;
+	for (const char *seg = star + 1; seg < last;) {
+		const char *seg_end = strchr(seg, '*');
+		const size_t seglen = (size_t)(seg_end - seg);
+		while (s + seglen <= end && cmp(seg, s, seglen)) {
+			s++;
+		}
+		if (s + seglen > end) {
+			return false;
+		}
+		s += seglen;
+		seg = seg_end + 1;
+	}
+	return true;
+}
+
 static int c2_parse_grp(const char *pattern, int offset, c2_ptr_t *presult, int level);
 
 static int c2_parse_target(const char *pattern, int offset, c2_ptr_t *presult);
@@ -334,6 +497,13 @@ static xcb_atom_t c2_get_atom_type(const c2_l_t *pleaf);
 
 static bool c2_match_once(session_t *ps, const struct managed_win *w, const c2_ptr_t cond);
 
+static c2_program_t *c2_compile(const c2_lptr_t *list);
+
+static void c2_program_free(c2_program_t *prog);
+
+static int c2_program_run(session_t *ps, const struct managed_win *w,
+                          const c2_program_t *prog, int start, int end);
+
 /**
  * Parse a condition string.
  */
@@ -797,6 +967,20 @@ fail:
 	return -1;
 }
 
+/**
+ * Prepare the string pattern of a leaf for matching window strings, see struct
+ * win_folded_str. Must be called once ptnstr and match_ignorecase are final.
+ */
+static void c2_l_fold_ptnstr(c2_l_t *pleaf) {
+	if (pleaf->match_ignorecase) {
+		free(pleaf->ptnstr_folded);
+		pleaf->ptnstr_folded = mstrdup_lower(pleaf->ptnstr);
+		pleaf->ptnstr_hash = str_hash(pleaf->ptnstr_folded);
+	} else {
+		pleaf->ptnstr_hash = str_hash(pleaf->ptnstr);
+	}
+}
+
 /**
  * Parse the pattern part of a leaf.
  */
@@ -897,6 +1081,7 @@ static int c2_parse_pattern(const char *pattern, int offset, c2_ptr_t *presult)
 		*ptptnstr = '\0';
 		pleaf->ptnstr = strdup(tptnstr);
 		free(tptnstr);
+		c2_l_fold_ptnstr(pleaf);
 	}
 
 	C2H_SKIP_SPACES();
@@ -985,6 +1170,7 @@ static int c2_parse_legacy(const char *pattern, int offset, c2_ptr_t *presult) {
 
 	// Copy the pattern
 	pleaf->ptnstr = strdup(pattern + offset);
+	c2_l_fold_ptnstr(pleaf);
 
 	return offset;
 
@@ -1012,11 +1198,16 @@ static bool c2_l_postprocess(session_t *ps, c2_l_t *pleaf) {
 		}
 	}
 
-	// Insert target Atom into atom track list
-	if (pleaf->tgtatom) {
+	// Insert target Atom into atom track list. fullscreen reads _NET_WM_STATE, track
+	// it too so the condition is matched again when it changes.
+	xcb_atom_t track_atom = pleaf->tgtatom;
+	if (pleaf->predef == C2_L_PFULLSCREEN) {
+		track_atom = ps->atoms->a_NET_WM_STATE;
+	}
+	if (track_atom) {
 		bool found = false;
 		for (latom_t *platom = ps->track_atom_lst; platom; platom = platom->next) {
-			if (pleaf->tgtatom == platom->atom) {
+			if (track_atom == platom->atom) {
 				found = true;
 				break;
 			}
@@ -1024,7 +1215,7 @@ static bool c2_l_postprocess(session_t *ps, c2_l_t *pleaf) {
 		if (!found) {
 			auto pnew = cmalloc(latom_t);
 			pnew->next = ps->track_atom_lst;
-			pnew->atom = pleaf->tgtatom;
+			pnew->atom = track_atom;
 			ps->track_atom_lst = pnew;
 		}
 	}
@@ -1051,35 +1242,48 @@ static bool c2_l_postprocess(session_t *ps, c2_l_t *pleaf) {
 		}
 	}
 
+	// Wildcard patterns
+	if (C2_L_PTSTRING == pleaf->ptntype && C2_L_MWILDCARD == pleaf->match) {
+		pleaf->match_simple_glob =
+		    c2h_is_simple_glob(pleaf->ptnstr, pleaf->match_ignorecase);
+	}
+
 	// PCRE patterns
 	if (C2_L_PTSTRING == pleaf->ptntype && C2_L_MPCRE == pleaf->match) {
 #ifdef CONFIG_REGEX_PCRE
-		const char *error = NULL;
-		int erroffset = 0;
-		int options = 0;
+		int errorcode = 0;
+		PCRE2_SIZE erroffset = 0;
+		uint32_t options = 0;
 
 		// Ignore case flag
 		if (pleaf->match_ignorecase)
-			options |= PCRE_CASELESS;
+			options |= PCRE2_CASELESS;
 
 		// Compile PCRE expression
-		pleaf->regex_pcre =
-		    pcre_compile(pleaf->ptnstr, options, &error, &erroffset, NULL);
+		pleaf->regex_pcre = pcre2_compile((PCRE2_SPTR)pleaf->ptnstr,
+		                                  PCRE2_ZERO_TERMINATED, options,
+		                                  &errorcode, &erroffset, NULL);
 		if (!pleaf->regex_pcre) {
+			PCRE2_UCHAR error[256];
+			pcre2_get_error_message(errorcode, error, sizeof(error));
 			log_error("Pattern \"%s\": PCRE regular expression parsing "
 			          "failed on "
-			          "offset %d: %s",
-			          pleaf->ptnstr, erroffset, error);
+			          "offset %zu: %s",
+			          pleaf->ptnstr, (size_t)erroffset, (char *)error);
 			return false;
 		}
-#ifdef CONFIG_REGEX_PCRE_JIT
-		pleaf->regex_pcre_extra =
-		    pcre_study(pleaf->regex_pcre, PCRE_STUDY_JIT_COMPILE, &error);
-		if (!pleaf->regex_pcre_extra) {
-			printf("Pattern \"%s\": PCRE regular expression study failed: %s",
-			       pleaf->ptnstr, error);
+		// Fall back to the interpreter if JIT isn't available
+		errorcode = pcre2_jit_compile(pleaf->regex_pcre, PCRE2_JIT_COMPLETE);
+		if (errorcode) {
+			PCRE2_UCHAR error[256];
+			pcre2_get_error_message(errorcode, error, sizeof(error));
+			log_debug("Pattern \"%s\": PCRE regular expression JIT compilation "
+			          "failed: %s",
+			          pleaf->ptnstr, (char *)error);
 		}
-#endif
+		pleaf->regex_pcre_match =
+		    pcre2_match_data_create_from_pattern(pleaf->regex_pcre, NULL);
+		allocchk(pleaf->regex_pcre_match);
 
 		// Free the target string
 		// free(pleaf->tgt);
@@ -1093,6 +1297,22 @@ static bool c2_l_postprocess(session_t *ps, c2_l_t *pleaf) {
 	return true;
 }
 
+/**
+ * Get what a condition tree depends on.
+ */
+static unsigned int c2_tree_get_deps(c2_ptr_t node) {
+	if (node.isbranch) {
+		return node.b ? c2_tree_get_deps(node.b->opr1) | c2_tree_get_deps(node.b->opr2) : 0;
+	}
+	if (!node.l) {
+		return 0;
+	}
+	if (node.l->predef == C2_L_PUNDEFINED) {
+		return C2_DEP_PROPERTY;
+	}
+	return C2_PREDEFS[node.l->predef].deps;
+}
+
 static bool c2_tree_postprocess(session_t *ps, c2_ptr_t node) {
 	if (!node.isbranch) {
 		return c2_l_postprocess(ps, node.l);
@@ -1109,8 +1329,22 @@ bool c2_list_postprocess(session_t *ps, c2_lptr_t *list) {
 			return false;
 		head = head->next;
 	}
+
+	if (list) {
+		c2_program_free(list->program);
+		list->program = c2_compile(list);
+		list->deps = 0;
+		for (head = list; head; head = head->next) {
+			list->deps |= c2_tree_get_deps(head->ptr);
+		}
+	}
 	return true;
 }
+
+unsigned int c2_list_get_deps(const c2_lptr_t *list) {
+	return list ? list->deps : 0;
+}
+
 /**
  * Free a condition tree.
  */
@@ -1135,9 +1369,10 @@ static void c2_free(c2_ptr_t p) {
 
 		free(pleaf->tgt);
 		free(pleaf->ptnstr);
+		free(pleaf->ptnstr_folded);
 #ifdef CONFIG_REGEX_PCRE
-		pcre_free(pleaf->regex_pcre);
-		LPCRE_FREE_STUDY(pleaf->regex_pcre_extra);
+		pcre2_match_data_free(pleaf->regex_pcre_match);
+		pcre2_code_free(pleaf->regex_pcre);
 #endif
 		free(pleaf);
 	}
@@ -1152,6 +1387,7 @@ c2_lptr_t *c2_free_lptr(c2_lptr_t *lp) {
 
 	c2_lptr_t *pnext = lp->next;
 	c2_free(lp->ptr);
+	c2_program_free(lp->program);
 	free(lp);
 
 	return pnext;
@@ -1344,8 +1580,8 @@ static inline void c2_match_once_leaf(session_t *ps, const struct managed_win *w
 		// A raw window property
 		else {
 			winprop_t prop =
-			    x_get_prop_with_offset(ps, wid, pleaf->tgtatom, idx, 1L,
-			                           c2_get_atom_type(pleaf), pleaf->format);
+			    c2_get_prop(ps, w, wid, pleaf->tgtatom, idx, 1L,
+			                c2_get_atom_type(pleaf), pleaf->format);
 			if (prop.nitems) {
 				*perr = false;
 				tgt = winprop_get_int(prop);
@@ -1376,22 +1612,36 @@ static inline void c2_match_once_leaf(session_t *ps, const struct managed_win *w
 	case C2_L_PTSTRING: {
 		const char *tgt = NULL;
 		char *tgt_free = NULL;
+		// Lower case copy and hashes of tgt, if it is a window string
+		const struct win_folded_str *folded = NULL;
 
 		// A predefined target
 		if (pleaf->predef != C2_L_PUNDEFINED) {
 			switch (pleaf->predef) {
 			case C2_L_PWINDOWTYPE: tgt = WINTYPES[w->window_type]; break;
-			case C2_L_PNAME: tgt = w->name; break;
-			case C2_L_PCLASSG: tgt = w->class_general; break;
-			case C2_L_PCLASSI: tgt = w->class_instance; break;
-			case C2_L_PROLE: tgt = w->role; break;
+			case C2_L_PNAME:
+				tgt = w->name;
+				folded = &w->name_folded;
+				break;
+			case C2_L_PCLASSG:
+				tgt = w->class_general;
+				folded = &w->class_general_folded;
+				break;
+			case C2_L_PCLASSI:
+				tgt = w->class_instance;
+				folded = &w->class_instance_folded;
+				break;
+			case C2_L_PROLE:
+				tgt = w->role;
+				folded = &w->role_folded;
+				break;
 			default: assert(0); break;
 			}
 		} else if (pleaf->type == C2_L_TATOM) {
 			// An atom type property, convert it to string
 			winprop_t prop =
-			    x_get_prop_with_offset(ps, wid, pleaf->tgtatom, idx, 1L,
-			                           c2_get_atom_type(pleaf), pleaf->format);
+			    c2_get_prop(ps, w, wid, pleaf->tgtatom, idx, 1L,
+			                c2_get_atom_type(pleaf), pleaf->format);
 			xcb_atom_t atom = (xcb_atom_t)winprop_get_int(prop);
 			if (atom) {
 				xcb_get_atom_name_reply_t *reply = xcb_get_atom_name_reply(
@@ -1411,7 +1661,7 @@ static inline void c2_match_once_leaf(session_t *ps, const struct managed_win *w
 			// Not an atom type, just fetch the string list
 			char **strlst = NULL;
 			int nstr;
-			if (wid_get_text_prop(ps, wid, pleaf->tgtatom, &strlst, &nstr) &&
+			if (c2_get_text_prop(ps, w, wid, pleaf->tgtatom, &strlst, &nstr) &&
 			    nstr > idx) {
 				tgt_free = strdup(strlst[idx]);
 				tgt = tgt_free;
@@ -1426,25 +1676,45 @@ static inline void c2_match_once_leaf(session_t *ps, const struct managed_win *w
 			return;
 		}
 
+		// Window strings come with a lower case copy, case insensitive patterns
+		// are matched against it instead of folding the string every time
+		if (folded && !folded->folded) {
+			folded = NULL;
+		}
+		const bool use_folded =
+		    folded && pleaf->match_ignorecase && pleaf->ptnstr_folded;
+		const char *ftgt = use_folded ? folded->folded : tgt;
+		const char *fptn = use_folded ? pleaf->ptnstr_folded : pleaf->ptnstr;
+		const uint32_t fhash =
+		    folded ? (use_folded ? folded->folded_hash : folded->hash) : 0;
+
 		// Actual matching
 		switch (pleaf->op) {
 		case C2_L_OEXISTS: *pres = true; break;
 		case C2_L_OEQ:
 			switch (pleaf->match) {
 			case C2_L_MEXACT:
-				if (pleaf->match_ignorecase)
+				if (folded) {
+					// Compare the hashes first, most comparisons fail
+					*pres = fhash == pleaf->ptnstr_hash &&
+					        !strcmp(ftgt, fptn);
+				} else if (pleaf->match_ignorecase)
 					*pres = !strcasecmp(tgt, pleaf->ptnstr);
 				else
 					*pres = !strcmp(tgt, pleaf->ptnstr);
 				break;
 			case C2_L_MCONTAINS:
-				if (pleaf->match_ignorecase)
+				if (use_folded)
+					*pres = strstr(ftgt, fptn);
+				else if (pleaf->match_ignorecase)
 					*pres = strcasestr(tgt, pleaf->ptnstr);
 				else
 					*pres = strstr(tgt, pleaf->ptnstr);
 				break;
 			case C2_L_MSTART:
-				if (pleaf->match_ignorecase)
+				if (use_folded)
+					*pres = !strncmp(ftgt, fptn, strlen(fptn));
+				else if (pleaf->match_ignorecase)
 					*pres = !strncasecmp(tgt, pleaf->ptnstr,
 					                     strlen(pleaf->ptnstr));
 				else
@@ -1452,6 +1722,12 @@ static inline void c2_match_once_leaf(session_t *ps, const struct managed_win *w
 					                 strlen(pleaf->ptnstr));
 				break;
 			case C2_L_MWILDCARD: {
+				if (pleaf->match_simple_glob) {
+					*pres = c2h_glob_match(fptn, ftgt,
+					                       pleaf->match_ignorecase &&
+					                           !use_folded);
+					break;
+				}
 				int flags = 0;
 				if (pleaf->match_ignorecase)
 					flags |= FNM_CASEFOLD;
@@ -1459,10 +1735,9 @@ static inline void c2_match_once_leaf(session_t *ps, const struct managed_win *w
 			} break;
 			case C2_L_MPCRE:
 #ifdef CONFIG_REGEX_PCRE
-				assert(strlen(tgt) <= INT_MAX);
-				*pres =
-				    (pcre_exec(pleaf->regex_pcre, pleaf->regex_pcre_extra,
-				               tgt, (int)strlen(tgt), 0, 0, NULL, 0) >= 0);
+				*pres = (pcre2_match(pleaf->regex_pcre, (PCRE2_SPTR)tgt,
+				                     strlen(tgt), 0, 0, pleaf->regex_pcre_match,
+				                     NULL) >= 0);
 #else
 				assert(0);
 #endif
@@ -1484,6 +1759,38 @@ static inline void c2_match_once_leaf(session_t *ps, const struct managed_win *w
 	}
 }
 
+/**
+ * Match a window against a single leaf window condition, errors count as not matching.
+ */
+static inline bool c2_match_leaf(session_t *ps, const struct managed_win *w,
+                                 const c2_l_t *pleaf) {
+	bool result = false;
+	bool error = true;
+
+	if (!pleaf)
+		return false;
+
+	c2_match_once_leaf(ps, w, pleaf, &result, &error);
+
+	// For EXISTS operator, no errors are fatal
+	if (C2_L_OEXISTS == pleaf->op && error) {
+		result = false;
+		error = false;
+	}
+
+#ifdef DEBUG_WINMATCH
+	log_trace("(%#010lx): leaf: result = %d, error = %d, "
+	          "client = %#010lx,  pattern = ",
+	          w->id, result, error, w->client_win);
+	c2_dump((c2_ptr_t){.isbranch = false, .l = (c2_l_t *)pleaf});
+#endif
+
+	if (error)
+		result = false;
+
+	return pleaf->neg ? !result : result;
+}
+
 /**
  * Match a window against a single window condition.
  *
@@ -1525,46 +1832,341 @@ static bool c2_match_once(session_t *ps, const struct managed_win *w, const c2_p
 	}
 	// Handle a leaf
 	else {
-		const c2_l_t *pleaf = cond.l;
+		return c2_match_leaf(ps, w, cond.l);
+	}
 
-		if (!pleaf)
+	// Postprocess the result
+	if (error)
+		result = false;
+
+	if (cond.b->neg)
+		result = !result;
+
+	return result;
+}
+
+static int c2_program_emit(c2_program_t *prog, int *capacity, c2_insn_t insn) {
+	if (prog->ninsns == *capacity) {
+		*capacity = max2(*capacity * 2, 16);
+		prog->insns = crealloc(prog->insns, *capacity);
+	}
+	prog->insns[prog->ninsns] = insn;
+	return prog->ninsns++;
+}
+
+/**
+ * Compile a condition tree, leaving its result in the register.
+ *
+ * AND and OR jump over their second operand when the first one decides the result,
+ * the register then already holds it.
+ *
+ * @param depth     stack depth before the tree is evaluated
+ * @param max_depth the deepest the stack gets, updated
+ */
+static void c2_compile_tree(c2_program_t *prog, int *capacity, c2_ptr_t node, int depth,
+                            int *max_depth) {
+	if (!node.isbranch || !node.b) {
+		c2_program_emit(prog, capacity,
+		                (c2_insn_t){.op = C2_OP_LEAF, .leaf = node.isbranch ? NULL : node.l});
+		return;
+	}
+
+	const c2_b_t *pb = node.b;
+	c2_compile_tree(prog, capacity, pb->opr1, depth, max_depth);
+	switch (pb->op) {
+	case C2_B_OAND:
+	case C2_B_OOR: {
+		int jump = c2_program_emit(
+		    prog, capacity,
+		    (c2_insn_t){.op = pb->op == C2_B_OAND ? C2_OP_JUMP_IF_FALSE : C2_OP_JUMP_IF_TRUE});
+		c2_compile_tree(prog, capacity, pb->opr2, depth, max_depth);
+		prog->insns[jump].target = prog->ninsns;
+	} break;
+	case C2_B_OXOR:
+		c2_program_emit(prog, capacity, (c2_insn_t){.op = C2_OP_PUSH});
+		*max_depth = max2(*max_depth, depth + 1);
+		c2_compile_tree(prog, capacity, pb->opr2, depth + 1, max_depth);
+		c2_program_emit(prog, capacity, (c2_insn_t){.op = C2_OP_XOR});
+		break;
+	default: assert(0);
+	}
+
+	if (pb->neg) {
+		c2_program_emit(prog, capacity, (c2_insn_t){.op = C2_OP_NOT});
+	}
+}
+
+/**
+ * Whether matching a leaf is the same as looking up the value of its target in an
+ * index.
+ */
+static bool c2_leaf_indexable(const c2_l_t *pleaf) {
+	if (pleaf->neg || pleaf->op != C2_L_OEQ) {
+		return false;
+	}
+	switch (pleaf->predef) {
+	case C2_L_PWINDOWTYPE:
+	case C2_L_PNAME:
+	case C2_L_PCLASSG:
+	case C2_L_PCLASSI:
+	case C2_L_PROLE:
+		return pleaf->ptntype == C2_L_PTSTRING && pleaf->match == C2_L_MEXACT &&
+		       !pleaf->match_ignorecase;
+	case C2_L_PID:
+		// The id of the client window, which is not indexed
+		if (pleaf->tgt_onframe) {
 			return false;
+		}
+		// fallthrough
+	case C2_L_PCLIENT:
+	case C2_L_PLEADER: return pleaf->ptntype == C2_L_PTINT;
+	default: return false;
+	}
+}
 
-		c2_match_once_leaf(ps, w, pleaf, &result, &error);
+/**
+ * Find a leaf a condition tree can only match if it matches.
+ *
+ * @return the leaf, NULL if there is no indexable one
+ */
+static const c2_l_t *c2_tree_index_leaf(c2_ptr_t node) {
+	if (!node.isbranch) {
+		return node.l && c2_leaf_indexable(node.l) ? node.l : NULL;
+	}
+	if (!node.b || node.b->neg || node.b->op != C2_B_OAND) {
+		return NULL;
+	}
+	auto pleaf = c2_tree_index_leaf(node.b->opr1);
+	return pleaf ? pleaf : c2_tree_index_leaf(node.b->opr2);
+}
 
-		// For EXISTS operator, no errors are fatal
-		if (C2_L_OEXISTS == pleaf->op && error) {
-			result = false;
-			error = false;
+/**
+ * Index the conditions of a list that can only match windows with a predefined target
+ * equal to a value, like `class_g = "Firefox"` or `name = "foo" && x > 10`. Matching
+ * then only has to run the conditions indexed under the values of the window, and the
+ * ones that couldn't be indexed.
+ */
+static void c2_index_build(c2_program_t *prog, const c2_lptr_t *list) {
+	auto index = ccalloc(C2_L_PROLE + 1, struct c2_index_entry *);
+	prog->unindexed = ccalloc(prog->nrules, int);
+	int rule = 0, nindexed = 0;
+	for (auto i = list; i; i = i->next, rule++) {
+		auto pleaf = c2_tree_index_leaf(i->ptr);
+		if (!pleaf) {
+			prog->unindexed[prog->nunindexed++] = rule;
+			continue;
 		}
 
-#ifdef DEBUG_WINMATCH
-		log_trace("(%#010lx): leaf: result = %d, error = %d, "
-		          "client = %#010lx,  pattern = ",
-		          w->id, result, error, w->client_win);
-		c2_dump(cond);
-#endif
+		struct c2_index_entry *e = NULL;
+		if (pleaf->ptntype == C2_L_PTSTRING) {
+			HASH_FIND(hh, index[pleaf->predef], pleaf->ptnstr,
+			          strlen(pleaf->ptnstr), e);
+		} else {
+			HASH_FIND(hh, index[pleaf->predef], &pleaf->ptnint, sizeof(long),
+			          e);
+		}
+		if (!e) {
+			e = ccalloc(1, struct c2_index_entry);
+			if (pleaf->ptntype == C2_L_PTSTRING) {
+				e->str = pleaf->ptnstr;
+				HASH_ADD_KEYPTR(hh, index[pleaf->predef], e->str,
+				                strlen(e->str), e);
+			} else {
+				e->num = pleaf->ptnint;
+				HASH_ADD(hh, index[pleaf->predef], num, sizeof(long), e);
+			}
+		}
+		if (e->nrules == e->capacity) {
+			e->capacity = max2(e->capacity * 2, 4);
+			e->rules = crealloc(e->rules, e->capacity);
+		}
+		e->rules[e->nrules++] = rule;
+		nindexed++;
 	}
 
-	// Postprocess the result
-	if (error)
-		result = false;
+	if (!nindexed) {
+		// Nothing to gain, matching would run every condition anyway
+		free(index);
+		return;
+	}
+	prog->index = index;
+}
 
-	if (cond.isbranch ? cond.b->neg : cond.l->neg)
-		result = !result;
+/**
+ * Find the conditions indexed under the value a predefined target has for a window.
+ */
+static const struct c2_index_entry *
+c2_index_lookup(const c2_program_t *prog, const struct managed_win *w, int predef) {
+	struct c2_index_entry *e = NULL;
+	const char *str = NULL;
+	long num = 0;
+	switch (predef) {
+	case C2_L_PWINDOWTYPE: str = WINTYPES[w->window_type]; break;
+	case C2_L_PNAME: str = w->name; break;
+	case C2_L_PCLASSG: str = w->class_general; break;
+	case C2_L_PCLASSI: str = w->class_instance; break;
+	case C2_L_PROLE: str = w->role; break;
+	case C2_L_PID: num = w->base.id; break;
+	case C2_L_PCLIENT: num = w->client_win; break;
+	case C2_L_PLEADER: num = w->leader; break;
+	default: assert(0); return NULL;
+	}
+	if (C2_PREDEFS[predef].type == C2_L_TSTRING) {
+		if (str) {
+			HASH_FIND(hh, prog->index[predef], str, strlen(str), e);
+		}
+	} else {
+		HASH_FIND(hh, prog->index[predef], &num, sizeof(long), e);
+	}
+	return e;
+}
 
-	return result;
+/**
+ * Run a compiled condition list on a window, through its index. Only the conditions
+ * indexed under the values of the window, and the unindexed ones, are run, still in
+ * the order of the list.
+ *
+ * @return the number of the first matching condition, -1 if none matched
+ */
+static int c2_index_run(session_t *ps, const struct managed_win *w,
+                        const c2_program_t *prog) {
+	// Candidate conditions, sorted lists to be merged
+	const int *lists[C2_L_PROLE + 2];
+	int lens[C2_L_PROLE + 2], pos[C2_L_PROLE + 2] = {0};
+	int nlists = 0;
+	for (int i = 0; i <= C2_L_PROLE; i++) {
+		if (!prog->index[i]) {
+			continue;
+		}
+		auto e = c2_index_lookup(prog, w, i);
+		if (e) {
+			lists[nlists] = e->rules;
+			lens[nlists++] = e->nrules;
+		}
+	}
+	lists[nlists] = prog->unindexed;
+	lens[nlists++] = prog->nunindexed;
+
+	while (true) {
+		int best = -1;
+		for (int i = 0; i < nlists; i++) {
+			if (pos[i] < lens[i] &&
+			    (best < 0 || lists[i][pos[i]] < lists[best][pos[best]])) {
+				best = i;
+			}
+		}
+		if (best < 0) {
+			return -1;
+		}
+		int rule = lists[best][pos[best]++];
+		if (c2_program_run(ps, w, prog, prog->rule_start[rule],
+		                   prog->rule_start[rule + 1]) >= 0) {
+			return rule;
+		}
+	}
 }
 
 /**
- * Match a window against a condition linked list.
+ * Compile a condition list into a program, so matching it doesn't have to chase the
+ * pointers of the condition trees.
  *
- * @param cache a place to cache the last matched condition
- * @param pdata a place to return the data
- * @return true if matched, false otherwise.
+ * @return the program, NULL if the conditions nest too deep to be compiled
  */
-bool c2_match(session_t *ps, const struct managed_win *w, const c2_lptr_t *condlst,
-              void **pdata) {
+static c2_program_t *c2_compile(const c2_lptr_t *list) {
+	auto prog = ccalloc(1, c2_program_t);
+	int capacity = 0, max_depth = 0, nrules = 0;
+	for (auto i = list; i; i = i->next) {
+		nrules++;
+	}
+	prog->nrules = nrules;
+	prog->data = ccalloc(nrules, void *);
+	prog->rule_start = ccalloc(nrules + 1, int);
+
+	int rule = 0;
+	for (auto i = list; i; i = i->next, rule++) {
+		prog->rule_start[rule] = prog->ninsns;
+		c2_compile_tree(prog, &capacity, i->ptr, 0, &max_depth);
+		c2_program_emit(prog, &capacity, (c2_insn_t){.op = C2_OP_MATCH, .rule = rule});
+		prog->data[rule] = i->data;
+	}
+	prog->rule_start[nrules] = prog->ninsns;
+
+	if (max_depth > C2_PROGRAM_MAX_STACK) {
+		log_debug("Conditions nest too deep, they won't be compiled");
+		c2_program_free(prog);
+		return NULL;
+	}
+	c2_index_build(prog, list);
+	return prog;
+}
+
+static void c2_program_free(c2_program_t *prog) {
+	if (!prog) {
+		return;
+	}
+	if (prog->index) {
+		for (int i = 0; i <= C2_L_PROLE; i++) {
+			struct c2_index_entry *e, *tmp;
+			HASH_ITER(hh, prog->index[i], e, tmp) {
+				HASH_DEL(prog->index[i], e);
+				free(e->rules);
+				free(e);
+			}
+		}
+		free(prog->index);
+	}
+	free(prog->unindexed);
+	free(prog->rule_start);
+	free(prog->insns);
+	free(prog->data);
+	free(prog);
+}
+
+/**
+ * Run part of a compiled condition list on a window.
+ *
+ * @param start first instruction to run, where a condition starts
+ * @param end   instruction to stop at, where a condition starts or the end of the
+ *              program
+ * @return the number of the first matching condition, -1 if none matched
+ */
+static int c2_program_run(session_t *ps, const struct managed_win *w,
+                          const c2_program_t *prog, int start, int end) {
+	bool stack[C2_PROGRAM_MAX_STACK];
+	int sp = 0;
+	bool reg = false;
+	for (int pc = start; pc < end; pc++) {
+		const c2_insn_t *insn = &prog->insns[pc];
+		switch (insn->op) {
+		case C2_OP_LEAF: reg = c2_match_leaf(ps, w, insn->leaf); break;
+		case C2_OP_JUMP_IF_FALSE:
+			if (!reg) {
+				pc = insn->target - 1;
+			}
+			break;
+		case C2_OP_JUMP_IF_TRUE:
+			if (reg) {
+				pc = insn->target - 1;
+			}
+			break;
+		case C2_OP_PUSH: stack[sp++] = reg; break;
+		case C2_OP_XOR: reg = stack[--sp] != reg; break;
+		case C2_OP_NOT: reg = !reg; break;
+		case C2_OP_MATCH:
+			if (reg) {
+				return insn->rule;
+			}
+			break;
+		}
+	}
+	return -1;
+}
+
+/**
+ * Match a window against a condition linked list, by walking the condition trees.
+ */
+static bool c2_match_list(session_t *ps, const struct managed_win *w,
+                          const c2_lptr_t *condlst, void **pdata) {
 	// Then go through the whole linked list
 	for (; condlst; condlst = condlst->next) {
 		if (c2_match_once(ps, w, condlst->ptr)) {
@@ -1576,3 +2178,210 @@ bool c2_match(session_t *ps, const struct managed_win *w, const c2_lptr_t *condl
 
 	return false;
 }
+
+/**
+ * Match a window against a condition linked list.
+ *
+ * @param cache a place to cache the last matched condition
+ * @param pdata a place to return the data
+ * @return true if matched, false otherwise.
+ */
+bool c2_match(session_t *ps, const struct managed_win *w, const c2_lptr_t *condlst,
+              void **pdata) {
+	if (!condlst || !condlst->program) {
+		return c2_match_list(ps, w, condlst, pdata);
+	}
+
+	const c2_program_t *prog = condlst->program;
+	int rule = prog->index ? c2_index_run(ps, w, prog)
+	                       : c2_program_run(ps, w, prog, 0, prog->ninsns);
+	if (rule < 0) {
+		return false;
+	}
+	if (pdata)
+		*pdata = condlst->program->data[rule];
+	return true;
+}
+
+TEST_CASE(c2_glob) {
+	const char *const patterns[] = {"",    "*",       "foo",   "foo*",  "*foo",
+	                                "*o*o*", "f*o", "**bar**", "a*a*a", "*Bar*"};
+	const char *const strs[] = {"",   "foo", "Foo", "foobar", "barfoo",
+	                            "fo", "aa",  "aaa", "xBARx"};
+	for (int i = 0; i < (int)ARR_SIZE(patterns); i++) {
+		TEST_TRUE(c2h_is_simple_glob(patterns[i], true));
+		for (int j = 0; j < (int)ARR_SIZE(strs); j++) {
+			TEST_EQUAL(c2h_glob_match(patterns[i], strs[j], false),
+			           !fnmatch(patterns[i], strs[j], 0));
+			TEST_EQUAL(c2h_glob_match(patterns[i], strs[j], true),
+			           !fnmatch(patterns[i], strs[j], FNM_CASEFOLD));
+		}
+	}
+	TEST_TRUE(!c2h_is_simple_glob("fo?", false));
+	TEST_TRUE(!c2h_is_simple_glob("[fb]oo", false));
+	TEST_TRUE(!c2h_is_simple_glob("\\*", false));
+}
+
+static const char *const c2_test_rules[] = {
+    "name = \"foo\" && x > 10",
+    "!(class_g *= \"term\" || width < 100) && !override_redirect",
+    "class_i ^= \"fir\" || (name %= \"*bar*\" && !(x <= 5 || width >= 500))",
+    "override_redirect || (name = \"baz\" && class_g = \"Baz\")",
+    "x = 20",
+    "class_g = \"xterm\" && width > 100",
+    "role = \"browser\"",
+    "name = \"baz\" && !override_redirect",
+    "class_i = \"firefox\"",
+};
+
+TEST_CASE(c2_program) {
+	auto ps = ccalloc(1, session_t);
+	auto w = ccalloc(1, struct managed_win);
+	c2_lptr_t *list = NULL;
+	for (int i = 0; i < (int)ARR_SIZE(c2_test_rules); i++) {
+		TEST_TRUE(c2_parse(&list, c2_test_rules[i], (void *)(intptr_t)(i + 1)));
+	}
+	TEST_TRUE(c2_list_postprocess(ps, list));
+	TEST_TRUE(list->program);
+	TEST_TRUE(list->program->index);
+	TEST_EQUAL(list->program->nunindexed, 4);
+	TEST_EQUAL(c2_list_get_deps(list),
+	           C2_DEP_NAME | C2_DEP_CLASS | C2_DEP_ROLE | C2_DEP_GEOMETRY |
+	               C2_DEP_OTHER);
+
+	char *const names[] = {"foo", "barbar", "baz", NULL};
+	char *const classes[] = {"xterm", "firefox", "Baz", NULL};
+	const int xs[] = {0, 5, 20};
+	const int widths[] = {50, 200, 800};
+	for (int i = 0; i < 4 * 4 * 3 * 3 * 2; i++) {
+		w->name = names[i % 4];
+		w->class_general = w->class_instance = classes[i / 4 % 4];
+		w->g.x = (int16_t)xs[i / 16 % 3];
+		w->g.width = (uint16_t)widths[i / 48 % 3];
+		w->a.override_redirect = (uint8_t)(i / 144 % 2);
+
+		void *data_tree = NULL, *data_program = NULL;
+		bool tree = c2_match_list(ps, w, list, &data_tree);
+		TEST_EQUAL(c2_match(ps, w, list, &data_program), tree);
+		TEST_EQUAL(data_program, data_tree);
+	}
+
+	while ((list = c2_free_lptr(list))) {
+	}
+	free(w);
+	free(ps);
+}
+
+/// Matching against the lower case copy of window strings gives the same results as
+/// ignoring case while matching.
+TEST_CASE(c2_folded) {
+	const char *const rules[] = {
+	    "name ?= \"FOO\"",        "name *?= \"BAR\"",    "class_g ^?= \"XT\"",
+	    "class_i %?= \"FIRE*\"",  "class_g %?= \"*a*\"", "name = \"baz\"",
+	    "name ^= \"bar\"",
+	};
+	char *const names[] = {"foo", "FOO", "barBAR", "baz", "Baz", NULL};
+	char *const classes[] = {"XTerm", "firefox", "Baz", NULL};
+	auto ps = ccalloc(1, session_t);
+	auto w = ccalloc(1, struct managed_win);
+	for (int i = 0; i < (int)ARR_SIZE(rules); i++) {
+		c2_lptr_t *list = NULL;
+		TEST_TRUE(c2_parse(&list, rules[i], NULL));
+		// Patterns are folded by the parser, matching doesn't need postprocessing
+		auto pleaf = list->ptr.l;
+		TEST_TRUE(!pleaf->match_ignorecase || pleaf->ptnstr_folded);
+		TEST_EQUAL(pleaf->ptnstr_hash,
+		           str_hash(pleaf->match_ignorecase ? pleaf->ptnstr_folded
+		                                            : pleaf->ptnstr));
+		TEST_TRUE(c2_list_postprocess(ps, list));
+		for (size_t j = 0; j < ARR_SIZE(names) * ARR_SIZE(classes); j++) {
+			w->name = names[j % ARR_SIZE(names)];
+			w->class_general = classes[j / ARR_SIZE(names)];
+			w->class_instance = w->class_general;
+			bool expected = c2_match(ps, w, list, NULL);
+
+			struct win_folded_str *folded[] = {&w->name_folded,
+			                                   &w->class_general_folded,
+			                                   &w->class_instance_folded};
+			const char *strs[] = {w->name, w->class_general,
+			                      w->class_instance};
+			for (int k = 0; k < 3; k++) {
+				if (strs[k]) {
+					auto f = folded[k];
+					f->folded = mstrdup_lower(strs[k]);
+					f->hash = str_hash(strs[k]);
+					f->folded_hash = str_hash(f->folded);
+				}
+			}
+			TEST_EQUAL(c2_match(ps, w, list, NULL), expected);
+			for (int k = 0; k < 3; k++) {
+				free(folded[k]->folded);
+				*folded[k] = (struct win_folded_str){0};
+			}
+		}
+		c2_free_lptr(list);
+	}
+	free(w);
+	free(ps);
+}
+
+#ifdef C2_BENCHMARK
+/// Not a test: compare the speed of walking condition trees, of running the compiled
+/// program, and of running it through its index. Only built with -Dbenchmark=true.
+TEST_CASE(c2_program_benchmark) {
+	const int nrules = 200, iterations = 2000;
+	auto ps = ccalloc(1, session_t);
+	auto w = ccalloc(1, struct managed_win);
+	c2_lptr_t *list = NULL;
+	for (int i = 0; i < nrules; i++) {
+		// Mostly class equality tests, like real configurations
+		char rule[128];
+		if (i % 4 == 0) {
+			snprintf(rule, sizeof(rule), "%s",
+			         c2_test_rules[(size_t)i / 4 % ARR_SIZE(c2_test_rules)]);
+		} else {
+			snprintf(rule, sizeof(rule), "class_g = \"App%d\"", i);
+		}
+		TEST_TRUE(c2_parse(&list, rule, NULL));
+	}
+	TEST_TRUE(c2_list_postprocess(ps, list));
+	w->name = "quux";
+	w->class_general = w->class_instance = "xterm";
+	w->g.width = 50;
+
+	struct timespec start, end, tree_time, program_time, index_time;
+	start = get_time_timespec();
+	for (int i = 0; i < iterations; i++) {
+		TEST_TRUE(!c2_match_list(ps, w, list, NULL));
+	}
+	end = get_time_timespec();
+	timespec_subtract(&tree_time, &end, &start);
+
+	start = get_time_timespec();
+	for (int i = 0; i < iterations; i++) {
+		auto prog = list->program;
+		TEST_EQUAL(c2_program_run(ps, w, prog, 0, prog->ninsns), -1);
+	}
+	end = get_time_timespec();
+	timespec_subtract(&program_time, &end, &start);
+
+	start = get_time_timespec();
+	for (int i = 0; i < iterations; i++) {
+		TEST_TRUE(!c2_match(ps, w, list, NULL));
+	}
+	end = get_time_timespec();
+	timespec_subtract(&index_time, &end, &start);
+
+	fprintf(stderr,
+	        "%d matches of %d conditions: tree %ld.%09lds, program %ld.%09lds, "
+	        "indexed %ld.%09lds, ",
+	        iterations, nrules, (long)tree_time.tv_sec, (long)tree_time.tv_nsec,
+	        (long)program_time.tv_sec, (long)program_time.tv_nsec,
+	        (long)index_time.tv_sec, (long)index_time.tv_nsec);
+
+	while ((list = c2_free_lptr(list))) {
+	}
+	free(w);
+	free(ps);
+}
+#endif
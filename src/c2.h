@@ -17,6 +17,24 @@ typedef struct _c2_lptr c2_lptr_t;
 typedef struct session session_t;
 struct managed_win;
 
+/// What about a window conditions can depend on. Masks of these tell which condition
+/// lists have to be matched again when a window changes.
+enum c2_dep {
+	C2_DEP_NAME = 1 << 0,
+	C2_DEP_CLASS = 1 << 1,
+	C2_DEP_ROLE = 1 << 2,
+	C2_DEP_WINDOW_TYPE = 1 << 3,
+	C2_DEP_GEOMETRY = 1 << 4,
+	C2_DEP_FOCUS = 1 << 5,
+	C2_DEP_LEADER = 1 << 6,
+	C2_DEP_CLIENT = 1 << 7,
+	/// Window properties that aren't predefined targets
+	C2_DEP_PROPERTY = 1 << 8,
+	/// Window attributes, shape, and anything else
+	C2_DEP_OTHER = 1 << 9,
+	C2_DEP_ALL = (1 << 10) - 1,
+};
+
 c2_lptr_t *c2_parse(c2_lptr_t **pcondlst, const char *pattern, void *data);
 
 c2_lptr_t *c2_free_lptr(c2_lptr_t *lp);
@@ -24,3 +42,7 @@ c2_lptr_t *c2_free_lptr(c2_lptr_t *lp);
 bool c2_match(session_t *ps, const struct managed_win *w, const c2_lptr_t *condlst, void **pdata);
 
 bool c2_list_postprocess(session_t *ps, c2_lptr_t *list);
+
+/// Get what the conditions of a list depend on, a mask of enum c2_dep. All of them if
+/// the list hasn't been postprocessed.
+unsigned int c2_list_get_deps(const c2_lptr_t *list);
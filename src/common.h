@@ -137,6 +137,9 @@ typedef struct session {
 	ev_timer unredir_timer;
 	/// Timer for fading
 	ev_timer fade_timer;
+	/// Time of the last frame that advanced fading, in milliseconds. 0 if no window
+	/// was fading in the last frame.
+	double fade_time;
 	/// Timer for delayed drawing, right now only used by
 	/// swopti
 	ev_timer delayed_draw_timer;
@@ -165,6 +168,10 @@ typedef struct session {
 	// === Display related ===
 	/// Whether the X server is grabbed by us
 	bool server_grabbed;
+	/// Number of times we grabbed the X server.
+	uint64_t grab_count;
+	/// Total and longest time we held the X server grabbed, in microseconds.
+	uint64_t grab_time_total, grab_time_max;
 	/// Display in use.
 	Display *dpy;
 	/// Previous handler of X errors
@@ -246,8 +253,6 @@ typedef struct session {
 	bool redirected;
 	/// Pre-generated alpha pictures.
 	xcb_render_picture_t *alpha_picts;
-	/// Time of last fading. In milliseconds.
-	long fade_time;
 	/// Head pointer of the error ignore linked list.
 	ignore_t *ignore_head;
 	/// Pointer to the <code>next</code> member of tail element of the error
@@ -371,6 +376,8 @@ typedef struct session {
 
 	// === Atoms ===
 	struct atom *atoms;
+	/// Cached window properties used by window rules.
+	struct prop_cache *prop_cache;
 	/// Array of atoms of all possible window types.
 	xcb_atom_t atoms_wintypes[NUM_WINTYPES];
 	/// Linked list of additional atoms to track.
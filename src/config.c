@@ -89,6 +89,8 @@ enum blur_method parse_blur_method(const char *src) {
 		return BLUR_METHOD_BOX;
 	} else if (strcmp(src, "gaussian") == 0) {
 		return BLUR_METHOD_GAUSSIAN;
+	} else if (strcmp(src, "dual_kawase") == 0) {
+		return BLUR_METHOD_DUAL_KAWASE;
 	} else if (strcmp(src, "none") == 0) {
 		return BLUR_METHOD_NONE;
 	}
@@ -514,6 +516,9 @@ char *parse_config(options_t *opt, const char *config_file, bool *shadow_enable,
 	    .refresh_rate = 0,
 	    .sw_opti = false,
 	    .use_damage = true,
+	    .xrender_buffers = 2,
+	    .damage_max_rects = 32,
+	    .damage_max_waste = 0.1,
 
 	    .shadow_red = 0.0,
 	    .shadow_green = 0.0,
@@ -75,6 +75,8 @@ typedef struct options {
 	/// Whether to sync X drawing with X Sync fence to avoid certain delay
 	/// issues with GLX backend.
 	bool xrender_sync_fence;
+	/// Number of back buffers in the swap chain of the xrender backend.
+	int xrender_buffers;
 	/// Whether to avoid using stencil buffer under GLX backend. Might be
 	/// unsafe.
 	bool glx_no_stencil;
@@ -127,6 +129,11 @@ typedef struct options {
 	bool vsync_use_glfinish;
 	/// Whether use damage information to help limit the area to paint
 	bool use_damage;
+	/// Maximum number of rectangles the damage of a window is coalesced into
+	/// each frame. 0 to disable coalescing.
+	int damage_max_rects;
+	/// Fraction of a merged damage rectangle that is allowed to be undamaged.
+	double damage_max_waste;
 
 	// === Shadow ===
 	/// Red, green and blue tone of the shadow.
@@ -402,6 +402,11 @@ char *parse_config_libconfig(options_t *opt, const char *config_file, bool *shad
 	double blur_deviation;
 	config_lookup_float(&cfg, "blur-deviation", &blur_deviation);
 	module_xsetfloat(ps->module_blur, "deviation", blur_deviation);
+	// --blur-strength
+	int blur_strength;
+	if (config_lookup_int(&cfg, "blur-strength", &blur_strength)) {
+		module_xsetint(ps->module_blur, "strength", blur_strength);
+	}
 	// --blur-background
 	if (config_lookup_bool(&cfg, "blur-background", &ival) && ival) {
 		if (*module_xgetint(ps->module_blur, "method") == BLUR_METHOD_NONE) {
@@ -476,6 +481,12 @@ char *parse_config_libconfig(options_t *opt, const char *config_file, bool *shad
 	}
 	// --xrender-sync-fence
 	lcfg_lookup_bool(&cfg, "xrender-sync-fence", &opt->xrender_sync_fence);
+	// --xrender-buffers
+	config_lookup_int(&cfg, "xrender-buffers", &opt->xrender_buffers);
+	// --damage-max-rects
+	config_lookup_int(&cfg, "damage-max-rects", &opt->damage_max_rects);
+	// --damage-max-waste
+	config_lookup_float(&cfg, "damage-max-waste", &opt->damage_max_waste);
 
 	if (lcfg_lookup_bool(&cfg, "clear-shadow", &bval))
 		log_warn("\"clear-shadow\" is removed as an option, and is always"
@@ -527,6 +538,10 @@ char *parse_config_libconfig(options_t *opt, const char *config_file, bool *shad
 
 		config_setting_lookup_float(blur_cfg, "deviation", &blur_deviation);
 		module_xsetfloat(ps->module_blur, "deviation", blur_deviation);
+
+		if (config_setting_lookup_int(blur_cfg, "strength", &blur_strength)) {
+			module_xsetint(ps->module_blur, "strength", blur_strength);
+		}
 	}
 
 	// Wintype settings
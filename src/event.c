@@ -17,6 +17,7 @@
 #include "config.h"
 #include "event.h"
 #include "log.h"
+#include "prop_cache.h"
 #include "region.h"
 #include "win.h"
 #include "x.h"
@@ -234,7 +235,7 @@ static void configure_win(session_t *ps, xcb_configure_notify_event_t *ce) {
 		pixman_region32_fini(&new_extents);
 
 		if (factor_change) {
-			win_on_factor_change(ps, mw);
+			win_on_factor_change(ps, mw, C2_DEP_GEOMETRY);
 			add_damage(ps, &damage);
 			win_update_screen(ps, mw);
 		}
@@ -418,6 +419,8 @@ static inline void ev_property_notify(session_t *ps, xcb_property_notify_event_t
 		free(reply);
 	}
 
+	prop_cache_invalidate(ps->prop_cache, ev->window, ev->atom);
+
 	if (ps->root == ev->window) {
 		if (ps->o.use_ewmh_active_win && ps->atoms->a_NET_ACTIVE_WINDOW == ev->atom) {
 			// to update focus
@@ -500,7 +503,7 @@ static inline void ev_property_notify(session_t *ps, xcb_property_notify_event_t
 	    (ps->atoms->aWM_NAME == ev->atom || ps->atoms->a_NET_WM_NAME == ev->atom)) {
 		auto w = find_toplevel(ps, ev->window);
 		if (w && win_update_name(ps, w) == 1) {
-			win_on_factor_change(ps, w);
+			win_on_factor_change(ps, w, C2_DEP_NAME);
 		}
 	}
 
@@ -509,7 +512,7 @@ static inline void ev_property_notify(session_t *ps, xcb_property_notify_event_t
 		auto w = find_toplevel(ps, ev->window);
 		if (w) {
 			win_get_class(ps, w);
-			win_on_factor_change(ps, w);
+			win_on_factor_change(ps, w, C2_DEP_CLASS);
 		}
 	}
 
@@ -517,7 +520,7 @@ static inline void ev_property_notify(session_t *ps, xcb_property_notify_event_t
 	if (ps->o.track_wdata && ps->atoms->aWM_WINDOW_ROLE == ev->atom) {
 		auto w = find_toplevel(ps, ev->window);
 		if (w && 1 == win_get_role(ps, w)) {
-			win_on_factor_change(ps, w);
+			win_on_factor_change(ps, w, C2_DEP_ROLE);
 		}
 	}
 
@@ -545,7 +548,7 @@ static inline void ev_property_notify(session_t *ps, xcb_property_notify_event_t
 			if (!w)
 				w = find_toplevel(ps, ev->window);
 			if (w)
-				win_on_factor_change(ps, w);
+				win_on_factor_change(ps, w, C2_DEP_PROPERTY);
 			break;
 		}
 	}
@@ -563,13 +566,10 @@ static inline void repair_win(session_t *ps, struct managed_win *w) {
 		set_ignore_cookie(
 		    ps, xcb_damage_subtract(ps->c, w->damage, XCB_NONE, XCB_NONE));
 	} else {
-		xcb_xfixes_region_t tmp = x_new_id(ps->c);
-		xcb_xfixes_create_region(ps->c, tmp, 0, NULL);
-		set_ignore_cookie(ps, xcb_damage_subtract(ps->c, w->damage, XCB_NONE, tmp));
-		x_fetch_region(ps->c, tmp, &parts);
-		xcb_xfixes_destroy_region(ps->c, tmp);
-		pixman_region32_translate(&parts, w->g.x + w->g.border_width,
-		                          w->g.y + w->g.border_width);
+		// The damage is fetched for all windows at once before the next frame,
+		// see fetch_pending_damage. The X server won't send us another
+		// DamageNotify for this window until then.
+		w->damage_fetch_pending = true;
 	}
 
 	w->ever_damaged = true;
@@ -582,11 +582,9 @@ static inline void repair_win(session_t *ps, struct managed_win *w) {
 		return;
 	}
 
-	// Remove the part in the damage area that could be ignored
-	if (w->reg_ignore && win_is_region_ignore_valid(ps, w))
-		pixman_region32_subtract(&parts, &parts, w->reg_ignore);
-
-	add_damage(ps, &parts);
+	// Damage is coalesced and added to the screen once per frame, see
+	// flush_pending_damage
+	pixman_region32_union(&w->pending_damage, &w->pending_damage, &parts);
 	pixman_region32_fini(&parts);
 }
 
@@ -30,6 +30,8 @@ typedef enum module_event_id {
 	MODEV_EARLY_EXIT,
 	MODEV_EXIT,
 
+	/* struct modev_paint_start *ud, emitted before the windows to paint are
+	 * decided */
 	MODEV_STAGE_PAINT_START,
 	MODEV_STAGE_PAINT_PREPARE,
 
@@ -41,7 +43,8 @@ typedef enum module_event_id {
 	MODEV_STAGE_WIN_SHADE,
 	MODEV_STAGE_WIN_COMPOSE,
 
-	/* ??? */
+	/* ???, except MODEV_STAGE_SCREEN_SHADOW: struct managed_window *ud, the bottom
+	 * window, emitted before any window is painted */
 	MODEV_STAGE_SCREEN_PREPARE,
 	MODEV_STAGE_SCREEN_DECORATE,
 	MODEV_STAGE_SCREEN_BLUR,
@@ -61,8 +64,13 @@ typedef enum module_event_id {
 	MODEV_WIN_DESTROYED,
 	MODEV_WIN_UNMAPPED,
 	MODEV_WIN_MAPPED,
+
+	/* struct modev_win_changed *ud */
 	MODEV_WIN_CHANGED,
 
+	/* struct modev_damage *ud */
+	MODEV_DAMAGE,
+
 	MODEV_SCREEN_REDIRECT_START,
 	MODEV_SCREEN_REDIRECT_DONE,
 
@@ -78,6 +86,28 @@ typedef enum module_event_id {
 	NUM_MODEVENTS
 } modev_t;
 
+/// Argument of MODEV_STAGE_PAINT_START
+struct modev_paint_start {
+	/// Set by handlers that need another frame to be drawn soon, e.g. for fading
+	bool animating;
+};
+
+/// Argument of MODEV_DAMAGE
+struct modev_damage {
+	/// The window whose content has changed, or NULL if the damage has other causes
+	/// (window moved, mapped, root changed, etc.)
+	struct managed_win *w;
+	/// The damaged region, in global coordinates
+	const region_t *damage;
+};
+
+/// Argument of MODEV_WIN_CHANGED
+struct modev_win_changed {
+	struct managed_win *w;
+	/// What changed about the window, a mask of enum c2_dep
+	unsigned int changed;
+};
+
 /// Opaque module type
 typedef struct module module_t;
 /// Event Handler
@@ -1,5 +1,6 @@
 #include "module.h"
 #include "compton-compat/common.h"
+#include "backend/backend_common.h"
 
 static int on_backend_create(modev_t evid, module_t *module, session_t *ps, void *ud) {
 	UNUSED(module);
@@ -80,6 +81,7 @@ static int on_backend_destroy(modev_t evid, module_t *module, session_t *ps, voi
 	}
 
 	if (ps->backend_data) {
+		backend_clear_shadow_cache(ps->backend_data);
 		ps->backend_data->ops->deinit(ps->backend_data);
 		ps->backend_data = NULL;
 	}
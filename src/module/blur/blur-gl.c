@@ -7,6 +7,8 @@ typedef struct {
 	GLint unifm_opacity;
 	GLint orig_loc;
 	GLint texorig_loc;
+	/// Area of the source texture that can be sampled (dual_kawase only)
+	GLint texbounds_loc;
 } gl_blur_shader_t;
 
 struct gl_blur_context {
@@ -20,12 +22,19 @@ struct gl_blur_context {
 	/// Temporary fbo used for blurring
 	GLuint blur_fbo;
 
+	/// Vertex data for the blur region, and for the resized blur region
+	struct gl_stream_buffer vertex_stream[2];
+	struct gl_vertex_scratch vertex_scratch[2];
+
 	int texture_width, texture_height;
 
 	/// How much do we need to resize the damaged region for blurring.
 	int resize_width, resize_height;
 
 	int npasses;
+
+	/// Bilinear sampler for the dual_kawase method, which samples between texels
+	GLuint sampler;
 };
 
 bool gl_blur(backend_t *base, double opacity, void *, const region_t *reg_blur,
@@ -33,6 +42,105 @@ bool gl_blur(backend_t *base, double opacity, void *, const region_t *reg_blur,
 void *gl_create_blur_context(backend_t *base, enum blur_method, void *args);
 void gl_destroy_blur_context(backend_t *base, void *ctx);
 void gl_get_blur_size(void *blur_context, int *width, int *height);
+void *gl_blur_cache_new(backend_t *base, int width, int height);
+void gl_blur_cache_free(backend_t *base, void *cache);
+void gl_blur_cache_save(backend_t *base, void *cache, int x, int y, const region_t *reg);
+void gl_blur_cache_restore(backend_t *base, void *cache, int x, int y,
+                           const region_t *reg);
+
+/// Blur `extent` of the back buffer with the dual_kawase method, and draw the result
+/// into the `nrects` rectangles uploaded to the first vertex stream.
+///
+/// Level 0 is `extent` on the screen, level k is half the size of level k - 1. The
+/// intermediate levels are stored in the bottom left corner of the blur textures,
+/// level k in `blur_texture[k % 2]`, so every pass reads one of the textures and
+/// writes the other.
+static bool gl_dual_kawase_blur(struct gl_data *gd, struct gl_blur_context *bctx,
+                                double opacity, const rect_t *extent, int nrects) {
+	int iterations = bctx->npasses / 2;
+	int level_width[DUAL_KAWASE_MAX_ITERATIONS + 1],
+	    level_height[DUAL_KAWASE_MAX_ITERATIONS + 1];
+	level_width[0] = extent->x2 - extent->x1;
+	level_height[0] = extent->y2 - extent->y1;
+
+	// One quad for each of the levels above 0, covering the whole level. Texture
+	// coordinates are the same as the vertex coordinates, the shaders scale them.
+	GLint coord[DUAL_KAWASE_MAX_ITERATIONS * 16];
+	GLuint indices[DUAL_KAWASE_MAX_ITERATIONS * 6];
+	for (int k = 1; k <= iterations; k++) {
+		level_width[k] = max2(1, (level_width[k - 1] + 1) / 2);
+		level_height[k] = max2(1, (level_height[k - 1] + 1) / 2);
+		GLint w = level_width[k], h = level_height[k];
+		memcpy(&coord[(k - 1) * 16],
+		       (GLint[]){0, 0, 0, 0, w, 0, w, 0, w, h, w, h, 0, h, 0, h},
+		       sizeof(GLint) * 16);
+		GLuint u = (GLuint)((k - 1) * 4);
+		memcpy(&indices[(k - 1) * 6],
+		       (GLuint[]){u + 0, u + 1, u + 2, u + 2, u + 3, u + 0}, sizeof(GLuint) * 6);
+	}
+	gl_stream_buffer_upload(&bctx->vertex_stream[1], coord,
+	                        (long)sizeof(GLint) * iterations * 16, indices,
+	                        (long)sizeof(GLuint) * iterations * 6);
+	glEnableVertexAttribArray(vert_coord_loc);
+	glEnableVertexAttribArray(vert_in_texcoord_loc);
+	glVertexAttribPointer(vert_coord_loc, 2, GL_INT, GL_FALSE, sizeof(GLint) * 4, NULL);
+	glVertexAttribPointer(vert_in_texcoord_loc, 2, GL_INT, GL_FALSE,
+	                      sizeof(GLint) * 4, (void *)(sizeof(GLint) * 2));
+
+	bool ret = true;
+	glBindSampler(0, bctx->sampler);
+	for (int i = 0; i < bctx->npasses; i++) {
+		const gl_blur_shader_t *p = &bctx->blur_shader[i];
+		// Levels read and written by this pass
+		int src = i < iterations ? i : 2 * iterations - i;
+		int dst = i < iterations ? i + 1 : 2 * iterations - i - 1;
+		assert(p->prog);
+
+		glUseProgram(p->prog);
+		if (src == 0) {
+			glBindTexture(GL_TEXTURE_2D, gd->back_texture);
+			glUniform2f(p->texorig_loc, (GLfloat)extent->x1,
+			            (GLfloat)(gd->height - extent->y2));
+			glUniform4f(p->texbounds_loc, 0.5f, 0.5f, (GLfloat)gd->width - 0.5f,
+			            (GLfloat)gd->height - 0.5f);
+		} else {
+			// Don't sample the stale content around the level
+			glBindTexture(GL_TEXTURE_2D, bctx->blur_texture[src % 2]);
+			glUniform2f(p->texorig_loc, 0, 0);
+			glUniform4f(p->texbounds_loc, 0.5f, 0.5f,
+			            (GLfloat)level_width[src] - 0.5f,
+			            (GLfloat)level_height[src] - 0.5f);
+		}
+
+		if (dst == 0) {
+			// Last pass, draw directly into the back buffer, with the original
+			// regions
+			glBindVertexArray(bctx->vertex_stream[0].vao);
+			glBindFramebuffer(GL_FRAMEBUFFER, gd->back_fbo);
+			glUniform1f(p->unifm_opacity, (float)opacity);
+			glViewport(0, 0, gd->width, gd->height);
+			glDrawElements(GL_TRIANGLES, nrects * 6, GL_UNSIGNED_INT, NULL);
+			break;
+		}
+
+		glBindVertexArray(bctx->vertex_stream[1].vao);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, bctx->blur_fbo);
+		glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+		                       GL_TEXTURE_2D, bctx->blur_texture[dst % 2], 0);
+		glDrawBuffer(GL_COLOR_ATTACHMENT0);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			log_error("Framebuffer attachment failed.");
+			ret = false;
+			break;
+		}
+		glUniform1f(p->unifm_opacity, 1.0);
+		glViewport(0, 0, bctx->texture_width, bctx->texture_height);
+		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT,
+		               (void *)(sizeof(GLuint) * 6 * (size_t)(dst - 1)));
+	}
+	glBindSampler(0, 0);
+	return ret;
+}
 
 /**
  * Blur contents in a particular region.
@@ -105,43 +213,43 @@ bool gl_blur(backend_t *base, double opacity, void *ctx, const region_t *reg_blu
 		return true;
 	}
 
-	auto coord = ccalloc(nrects * 16, GLint);
-	auto indices = ccalloc(nrects * 6, GLuint);
+	gl_vertex_scratch_reserve(&bctx->vertex_scratch[0], nrects);
+	GLint *coord = bctx->vertex_scratch[0].coord;
+	GLuint *indices = bctx->vertex_scratch[0].indices;
 	x_rect_to_coords(nrects, rects, extent_resized->x1, extent_resized->y2,
 	                 bctx->texture_height, gd->height, false, coord, indices);
 
-	auto coord_resized = ccalloc(nrects_resized * 16, GLint);
-	auto indices_resized = ccalloc(nrects_resized * 6, GLuint);
-	x_rect_to_coords(nrects_resized, rects_resized, extent_resized->x1,
-	                 extent_resized->y2, bctx->texture_height, bctx->texture_height,
-	                 false, coord_resized, indices_resized);
-	pixman_region32_fini(&reg_blur_resized);
-
-	GLuint vao[2];
-	glGenVertexArrays(2, vao);
-	GLuint bo[4];
-	glGenBuffers(4, bo);
-
-	glBindVertexArray(vao[0]);
-	glBindBuffer(GL_ARRAY_BUFFER, bo[0]);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bo[1]);
-	glBufferData(GL_ARRAY_BUFFER, (long)sizeof(*coord) * nrects * 16, coord, GL_STATIC_DRAW);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, (long)sizeof(*indices) * nrects * 6,
-	             indices, GL_STATIC_DRAW);
+	gl_stream_buffer_upload(&bctx->vertex_stream[0], coord,
+	                        (long)sizeof(*coord) * nrects * 16, indices,
+	                        (long)sizeof(*indices) * nrects * 6);
 	glEnableVertexAttribArray(vert_coord_loc);
 	glEnableVertexAttribArray(vert_in_texcoord_loc);
 	glVertexAttribPointer(vert_coord_loc, 2, GL_INT, GL_FALSE, sizeof(GLint) * 4, NULL);
 	glVertexAttribPointer(vert_in_texcoord_loc, 2, GL_INT, GL_FALSE,
 	                      sizeof(GLint) * 4, (void *)(sizeof(GLint) * 2));
 
-	glBindVertexArray(vao[1]);
-	glBindBuffer(GL_ARRAY_BUFFER, bo[2]);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bo[3]);
-	glBufferData(GL_ARRAY_BUFFER, (long)sizeof(*coord_resized) * nrects_resized * 16,
-	             coord_resized, GL_STATIC_DRAW);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-	             (long)sizeof(*indices_resized) * nrects_resized * 6, indices_resized,
-	             GL_STATIC_DRAW);
+	if (bctx->method == BLUR_METHOD_DUAL_KAWASE) {
+		// The whole resized extent is blurred, the rectangles are only used
+		// for the last pass
+		ret = gl_dual_kawase_blur(gd, bctx, opacity, extent_resized, nrects);
+		pixman_region32_fini(&reg_blur_resized);
+		goto end;
+	}
+
+	gl_vertex_scratch_reserve(&bctx->vertex_scratch[1], nrects_resized);
+	GLint *coord_resized = bctx->vertex_scratch[1].coord;
+	GLuint *indices_resized = bctx->vertex_scratch[1].indices;
+	x_rect_to_coords(nrects_resized, rects_resized, extent_resized->x1,
+	                 extent_resized->y2, bctx->texture_height, bctx->texture_height,
+	                 false, coord_resized, indices_resized);
+	pixman_region32_fini(&reg_blur_resized);
+
+	GLuint vao[2] = {bctx->vertex_stream[0].vao, bctx->vertex_stream[1].vao};
+
+	gl_stream_buffer_upload(&bctx->vertex_stream[1], coord_resized,
+	                        (long)sizeof(*coord_resized) * nrects_resized * 16,
+	                        indices_resized,
+	                        (long)sizeof(*indices_resized) * nrects_resized * 6);
 	glEnableVertexAttribArray(vert_coord_loc);
 	glEnableVertexAttribArray(vert_in_texcoord_loc);
 	glVertexAttribPointer(vert_coord_loc, 2, GL_INT, GL_FALSE, sizeof(GLint) * 4, NULL);
@@ -214,15 +322,7 @@ end:
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 	glBindTexture(GL_TEXTURE_2D, 0);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-	glDeleteBuffers(4, bo);
 	glBindVertexArray(0);
-	glDeleteVertexArrays(2, vao);
-
-	free(indices);
-	free(coord);
-	free(indices_resized);
-	free(coord_resized);
 
 	gl_check_err();
 
@@ -244,16 +344,151 @@ void gl_destroy_blur_context(backend_t *base attr_unused, void *ctx) {
 		gl_free_blur_shader(&bctx->blur_shader[i]);
 	}
 	free(bctx->blur_shader);
+	if (bctx->sampler) {
+		glDeleteSamplers(1, &bctx->sampler);
+	}
 
 	glDeleteTextures(bctx->npasses > 1 ? 2 : 1, bctx->blur_texture);
 	if (bctx->npasses > 1) {
 		glDeleteFramebuffers(1, &bctx->blur_fbo);
 	}
+	for (int i = 0; i < 2; i++) {
+		gl_stream_buffer_deinit(&bctx->vertex_stream[i]);
+		gl_vertex_scratch_free(&bctx->vertex_scratch[i]);
+	}
 	free(bctx);
 
 	gl_check_err();
 }
 
+/// Create the textures, framebuffer and vertex buffers shared by all blur methods.
+static bool gl_init_blur_buffers(struct gl_blur_context *ctx) {
+	// Texture size will be defined by gl_blur
+	glGenTextures(2, ctx->blur_texture);
+	glBindTexture(GL_TEXTURE_2D, ctx->blur_texture[0]);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, ctx->blur_texture[1]);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	gl_stream_buffer_init(&ctx->vertex_stream[0]);
+	gl_stream_buffer_init(&ctx->vertex_stream[1]);
+
+	// Generate FBO and textures when needed
+	glGenFramebuffers(1, &ctx->blur_fbo);
+	if (!ctx->blur_fbo) {
+		log_error("Failed to generate framebuffer object for blur");
+		return false;
+	}
+	return true;
+}
+
+/// Build the programs of the dual_kawase method: `iterations` passes that each halve
+/// the size of the image, followed by as many passes scaling it back up. Every
+/// program is built for one pass, so the projection matrices can be set up the same
+/// way as for the convolution passes.
+static bool gl_create_dual_kawase_passes(struct gl_blur_context *ctx,
+                                         struct dual_kawase_blur_args *args) {
+	// clang-format off
+	static const char *vert = GLSL(330,
+		uniform mat4 projection;
+		uniform vec2 texorig;
+		uniform float texscale;
+		layout(location = 0) in vec2 coord;
+		layout(location = 1) in vec2 in_texcoord;
+		out vec2 texcoord;
+		void main() {
+			gl_Position = projection * vec4(coord, 0, 1);
+			texcoord = in_texcoord * texscale + texorig;
+		}
+	);
+	static const char *down_frag = GLSL(330,
+		uniform sampler2D tex_src;
+		uniform float opacity;
+		uniform float offset;
+		uniform vec4 texbounds;
+		in vec2 texcoord;
+		out vec4 out_color;
+		vec4 fetch(vec2 pos) {
+			pos = clamp(pos, texbounds.xy, texbounds.zw);
+			return texture(tex_src, pos / vec2(textureSize(tex_src, 0)));
+		}
+		void main() {
+			vec4 sum = fetch(texcoord) * 4.0;
+			sum += fetch(texcoord + vec2(-offset, -offset));
+			sum += fetch(texcoord + vec2(offset, -offset));
+			sum += fetch(texcoord + vec2(-offset, offset));
+			sum += fetch(texcoord + vec2(offset, offset));
+			out_color = sum / 8.0 * opacity;
+		}
+	);
+	static const char *up_frag = GLSL(330,
+		uniform sampler2D tex_src;
+		uniform float opacity;
+		uniform float offset;
+		uniform vec4 texbounds;
+		in vec2 texcoord;
+		out vec4 out_color;
+		vec4 fetch(vec2 pos) {
+			pos = clamp(pos, texbounds.xy, texbounds.zw);
+			return texture(tex_src, pos / vec2(textureSize(tex_src, 0)));
+		}
+		void main() {
+			float h = offset / 2.0;
+			vec4 sum = fetch(texcoord + vec2(-offset, 0.0));
+			sum += fetch(texcoord + vec2(-h, h)) * 2.0;
+			sum += fetch(texcoord + vec2(0.0, offset));
+			sum += fetch(texcoord + vec2(h, h)) * 2.0;
+			sum += fetch(texcoord + vec2(offset, 0.0));
+			sum += fetch(texcoord + vec2(h, -h)) * 2.0;
+			sum += fetch(texcoord + vec2(0.0, -offset));
+			sum += fetch(texcoord + vec2(-h, -h)) * 2.0;
+			out_color = sum / 12.0 * opacity;
+		}
+	);
+	// clang-format on
+
+	int iterations;
+	float offset;
+	dual_kawase_params(args, &iterations, &offset);
+
+	ctx->npasses = iterations * 2;
+	ctx->blur_shader = ccalloc(ctx->npasses, gl_blur_shader_t);
+	for (int i = 0; i < ctx->npasses; i++) {
+		bool down = i < iterations;
+		auto pass = &ctx->blur_shader[i];
+		pass->prog = gl_create_program_from_str(vert, down ? down_frag : up_frag);
+		if (!pass->prog) {
+			log_error("Failed to create GLSL program.");
+			return false;
+		}
+		glBindFragDataLocation(pass->prog, 0, "out_color");
+		pass->unifm_opacity = glGetUniformLocationChecked(pass->prog, "opacity");
+		pass->texorig_loc = glGetUniformLocationChecked(pass->prog, "texorig");
+		pass->texbounds_loc = glGetUniformLocationChecked(pass->prog, "texbounds");
+		pass->orig_loc = -1;
+
+		// Texture coordinates are in pixels of the destination, the source is
+		// twice as large when downsampling, half as large when upsampling.
+		glUseProgram(pass->prog);
+		glUniform1f(glGetUniformLocationChecked(pass->prog, "texscale"),
+		            down ? 2.0f : 0.5f);
+		glUniform1f(glGetUniformLocationChecked(pass->prog, "offset"), offset);
+	}
+	glUseProgram(0);
+
+	glGenSamplers(1, &ctx->sampler);
+	glSamplerParameteri(ctx->sampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glSamplerParameteri(ctx->sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glSamplerParameteri(ctx->sampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glSamplerParameteri(ctx->sampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	ctx->resize_width = ctx->resize_height = dual_kawase_radius(iterations, offset);
+	return true;
+}
+
 /**
  * Initialize GL blur filters.
  */
@@ -269,6 +504,16 @@ void *gl_create_blur_context(backend_t *base, enum blur_method method, void *arg
 		return ctx;
 	}
 
+	if (method == BLUR_METHOD_DUAL_KAWASE) {
+		ctx->method = BLUR_METHOD_DUAL_KAWASE;
+		if (!gl_create_dual_kawase_passes(ctx, args) || !gl_init_blur_buffers(ctx)) {
+			gl_destroy_blur_context(&gd->base, ctx);
+			return NULL;
+		}
+		gl_check_err();
+		return ctx;
+	}
+
 	int nkernels;
 	ctx->method = BLUR_METHOD_KERNEL;
 	if (method == BLUR_METHOD_KERNEL) {
@@ -283,6 +528,18 @@ void *gl_create_blur_context(backend_t *base, enum blur_method method, void *arg
 		return ctx;
 	}
 
+	// Run the separable kernels as two one dimensional passes
+	struct conv **source_kernels = kernels;
+	int nsource_kernels = nkernels;
+	kernels = split_separable_kernels(source_kernels, nsource_kernels, &nkernels);
+	if (method != BLUR_METHOD_KERNEL) {
+		// We generated the blur kernels, so we need to free them
+		for (int i = 0; i < nsource_kernels; i++) {
+			free(source_kernels[i]);
+		}
+		free(source_kernels);
+	}
+
 	ctx->blur_shader = ccalloc(max2(2, nkernels), gl_blur_shader_t);
 
 	char *lc_numeric_old = strdup(setlocale(LC_NUMERIC, NULL));
@@ -379,30 +636,16 @@ void *gl_create_blur_context(backend_t *base, enum blur_method method, void *arg
 		ctx->npasses = nkernels;
 	}
 
-	// Texture size will be defined by gl_blur
-	glGenTextures(2, ctx->blur_texture);
-	glBindTexture(GL_TEXTURE_2D, ctx->blur_texture[0]);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glBindTexture(GL_TEXTURE_2D, ctx->blur_texture[1]);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	// Generate FBO and textures when needed
-	glGenFramebuffers(1, &ctx->blur_fbo);
-	if (!ctx->blur_fbo) {
-		log_error("Failed to generate framebuffer object for blur");
+	if (!gl_init_blur_buffers(ctx)) {
 		success = false;
 		goto out;
 	}
 
 out:
-	if (method != BLUR_METHOD_KERNEL) {
-		// We generated the blur kernels, so we need to free them
-		for (int i = 0; i < nkernels; i++) {
-			free(kernels[i]);
-		}
-		free(kernels);
+	for (int i = 0; i < nkernels; i++) {
+		free(kernels[i]);
 	}
+	free(kernels);
 
 	if (!success) {
 		gl_destroy_blur_context(&gd->base, ctx);
@@ -423,3 +666,79 @@ void gl_get_blur_size(void *blur_context, int *width, int *height) {
 	*width = ctx->resize_width;
 	*height = ctx->resize_height;
 }
+
+/// Storage for a blurred background
+struct gl_blur_cache {
+	GLuint texture, fbo;
+	int width, height;
+};
+
+void *gl_blur_cache_new(backend_t *base attr_unused, int width, int height) {
+	auto cache = ccalloc(1, struct gl_blur_cache);
+	cache->width = width;
+	cache->height = height;
+	cache->texture = gl_new_texture(GL_TEXTURE_2D);
+	glGenFramebuffers(1, &cache->fbo);
+	if (!cache->texture || !cache->fbo) {
+		log_error("Failed to allocate texture for blur cache");
+		gl_blur_cache_free(base, cache);
+		return NULL;
+	}
+
+	// Same format as the back texture, so we can blit between them
+	glBindTexture(GL_TEXTURE_2D, cache->texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_BGR, GL_UNSIGNED_BYTE,
+	             NULL);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, cache->fbo);
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+	                       cache->texture, 0);
+	glDrawBuffer(GL_COLOR_ATTACHMENT0);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	gl_check_err();
+	return cache;
+}
+
+void gl_blur_cache_free(backend_t *base attr_unused, void *cache_) {
+	struct gl_blur_cache *cache = cache_;
+	glDeleteFramebuffers(1, &cache->fbo);
+	glDeleteTextures(1, &cache->texture);
+	free(cache);
+}
+
+/// Copy `reg` between the back texture and the cache, whose top left corner is at
+/// (x, y) on the screen.
+static void gl_blur_cache_blit(struct gl_data *gd, struct gl_blur_cache *cache, int x,
+                               int y, const region_t *reg, bool save) {
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, save ? gd->back_fbo : cache->fbo);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, save ? cache->fbo : gd->back_fbo);
+	int nrects;
+	const rect_t *rects = pixman_region32_rectangles((region_t *)reg, &nrects);
+	// Both textures are y-inverted
+	int cache_bottom = y + cache->height;
+	for (int i = 0; i < nrects; i++) {
+		GLint sx1 = rects[i].x1, sy1 = gd->height - rects[i].y2,
+		      sx2 = rects[i].x2, sy2 = gd->height - rects[i].y1;
+		GLint cx1 = rects[i].x1 - x, cy1 = cache_bottom - rects[i].y2,
+		      cx2 = rects[i].x2 - x, cy2 = cache_bottom - rects[i].y1;
+		if (save) {
+			glBlitFramebuffer(sx1, sy1, sx2, sy2, cx1, cy1, cx2, cy2,
+			                  GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		} else {
+			glBlitFramebuffer(cx1, cy1, cx2, cy2, sx1, sy1, sx2, sy2,
+			                  GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		}
+	}
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	gl_check_err();
+}
+
+void gl_blur_cache_save(backend_t *base, void *cache, int x, int y, const region_t *reg) {
+	gl_blur_cache_blit((void *)base, cache, x, y, reg, true);
+}
+
+void gl_blur_cache_restore(backend_t *base, void *cache, int x, int y,
+                           const region_t *reg) {
+	gl_blur_cache_blit((void *)base, cache, x, y, reg, false);
+}
@@ -18,6 +18,12 @@ static void *xrender_create_blur_context(backend_t *base attr_unused, enum blur_
 		ret->method = BLUR_METHOD_NONE;
 		return ret;
 	}
+	if (method == BLUR_METHOD_DUAL_KAWASE) {
+		log_warn("Blur method 'dual_kawase' is not supported by the xrender "
+		         "backend, background blur is disabled.");
+		ret->method = BLUR_METHOD_NONE;
+		return ret;
+	}
 
 	ret->method = BLUR_METHOD_KERNEL;
 	struct conv **kernels;
@@ -29,6 +35,18 @@ static void *xrender_create_blur_context(backend_t *base attr_unused, enum blur_
 		kernels = generate_blur_kernel(method, args, &kernel_count);
 	}
 
+	// Run the separable kernels as two one dimensional passes
+	struct conv **source_kernels = kernels;
+	int source_kernel_count = kernel_count;
+	kernels = split_separable_kernels(source_kernels, source_kernel_count, &kernel_count);
+	if (method != BLUR_METHOD_KERNEL) {
+		// Kernels generated by generate_blur_kernel, so we need to free them.
+		for (int i = 0; i < source_kernel_count; i++) {
+			free(source_kernels[i]);
+		}
+		free(source_kernels);
+	}
+
 	ret->x_blur_kernel = ccalloc(kernel_count, struct x_convolution_kernel *);
 	for (int i = 0; i < kernel_count; i++) {
 		int center = kernels[i]->h * kernels[i]->w / 2;
@@ -39,13 +57,10 @@ static void *xrender_create_blur_context(backend_t *base attr_unused, enum blur_
 	}
 	ret->x_blur_kernel_count = kernel_count;
 
-	if (method != BLUR_METHOD_KERNEL) {
-		// Kernels generated by generate_blur_kernel, so we need to free them.
-		for (int i = 0; i < kernel_count; i++) {
-			free(kernels[i]);
-		}
-		free(kernels);
+	for (int i = 0; i < kernel_count; i++) {
+		free(kernels[i]);
 	}
+	free(kernels);
 	return ret;
 }
 
@@ -113,7 +128,7 @@ static bool xrender_blur(backend_t *backend_data, double opacity, void *ctx_,
 	x_set_picture_clip_region(c, tmp_picture[1], 0, 0, &clip);
 	pixman_region32_fini(&clip);
 
-	xcb_render_picture_t src_pict = xd->back[2], dst_pict = tmp_picture[0];
+	xcb_render_picture_t src_pict = xd->render_pict, dst_pict = tmp_picture[0];
 	auto alpha_pict = xd->alpha_pict[(int)(opacity * MAX_ALPHA)];
 	int current = 0;
 	x_set_picture_clip_region(c, src_pict, 0, 0, &reg_op_resized);
@@ -148,10 +163,10 @@ static bool xrender_blur(backend_t *backend_data, double opacity, void *ctx_,
 			                     XCB_NONE, dst_pict, 0, 0, 0, 0, 0, 0,
 			                     width_resized, height_resized);
 		} else {
-			x_set_picture_clip_region(c, xd->back[2], 0, 0, &reg_op);
+			x_set_picture_clip_region(c, xd->render_pict, 0, 0, &reg_op);
 			// This is the last pass, and we are doing more than 1 pass
 			xcb_render_composite(c, XCB_RENDER_PICT_OP_OVER, src_pict,
-			                     alpha_pict, xd->back[2], 0, 0, 0, 0,
+			                     alpha_pict, xd->render_pict, 0, 0, 0, 0,
 			                     to_i16_checked(extent_resized->x1),
 			                     to_i16_checked(extent_resized->y1),
 			                     width_resized, height_resized);
@@ -168,9 +183,9 @@ static bool xrender_blur(backend_t *backend_data, double opacity, void *ctx_,
 
 	// There is only 1 pass
 	if (i == 1) {
-		x_set_picture_clip_region(c, xd->back[2], 0, 0, &reg_op);
+		x_set_picture_clip_region(c, xd->render_pict, 0, 0, &reg_op);
 		xcb_render_composite(
-		    c, XCB_RENDER_PICT_OP_OVER, src_pict, alpha_pict, xd->back[2], 0, 0,
+		    c, XCB_RENDER_PICT_OP_OVER, src_pict, alpha_pict, xd->render_pict, 0, 0,
 		    0, 0, to_i16_checked(extent_resized->x1),
 		    to_i16_checked(extent_resized->y1), width_resized, height_resized);
 	}
@@ -180,3 +195,57 @@ static bool xrender_blur(backend_t *backend_data, double opacity, void *ctx_,
 	pixman_region32_fini(&reg_op);
 	return true;
 }
+
+static void *xrender_blur_cache_new(backend_t *base, int width, int height) {
+	struct _xrender_data *xd = (void *)base;
+	// Only keep the picture, the pixmap is freed with it
+	xcb_render_picture_t *pict = ccalloc(1, xcb_render_picture_t);
+	*pict = x_create_picture_with_visual(base->c, base->root, width, height,
+	                                     xd->default_visual, 0, NULL);
+	if (*pict == XCB_NONE) {
+		log_error("Failed to create picture for blur cache");
+		free(pict);
+		return NULL;
+	}
+	return pict;
+}
+
+static void xrender_blur_cache_free(backend_t *base, void *cache) {
+	xcb_render_picture_t *pict = cache;
+	xcb_render_free_picture(base->c, *pict);
+	free(pict);
+}
+
+/// Copy `reg` of the rendering buffer into the cache, whose top left corner is at
+/// (x, y) on the screen.
+static void
+xrender_blur_cache_save(backend_t *base, void *cache, int x, int y, const region_t *reg) {
+	struct _xrender_data *xd = (void *)base;
+	xcb_render_picture_t pict = *(xcb_render_picture_t *)cache;
+	const rect_t *extent = pixman_region32_extents((region_t *)reg);
+	x_clear_picture_clip_region(base->c, xd->render_pict);
+	x_set_picture_clip_region(base->c, pict, to_i16_checked(-x), to_i16_checked(-y),
+	                          reg);
+	xcb_render_composite(base->c, XCB_RENDER_PICT_OP_SRC, xd->render_pict, XCB_NONE,
+	                     pict, to_i16_checked(extent->x1), to_i16_checked(extent->y1),
+	                     0, 0, to_i16_checked(extent->x1 - x),
+	                     to_i16_checked(extent->y1 - y),
+	                     to_u16_checked(extent->x2 - extent->x1),
+	                     to_u16_checked(extent->y2 - extent->y1));
+}
+
+/// Copy `reg` of the cache back into the rendering buffer
+static void xrender_blur_cache_restore(backend_t *base, void *cache, int x, int y,
+                                       const region_t *reg) {
+	struct _xrender_data *xd = (void *)base;
+	xcb_render_picture_t pict = *(xcb_render_picture_t *)cache;
+	const rect_t *extent = pixman_region32_extents((region_t *)reg);
+	x_clear_picture_clip_region(base->c, pict);
+	x_set_picture_clip_region(base->c, xd->render_pict, 0, 0, reg);
+	xcb_render_composite(base->c, XCB_RENDER_PICT_OP_SRC, pict, XCB_NONE,
+	                     xd->render_pict, to_i16_checked(extent->x1 - x),
+	                     to_i16_checked(extent->y1 - y), 0, 0,
+	                     to_i16_checked(extent->x1), to_i16_checked(extent->y1),
+	                     to_u16_checked(extent->x2 - extent->x1),
+	                     to_u16_checked(extent->y2 - extent->y1));
+}
@@ -62,4 +62,91 @@ static struct conv **generate_blur_kernel(enum blur_method method, void *args, i
 	default: break;
 	}
 	return NULL;
-}
\ No newline at end of file
+}
+/// Maximum number of downsampling steps of the dual_kawase blur method
+#define DUAL_KAWASE_MAX_ITERATIONS 5
+
+struct dual_kawase_blur_args {
+	/// Blur radius to approximate, used if `strength` is not set
+	int size;
+	int strength;
+};
+
+/// Number of downsampling steps and sample offset of the dual_kawase blur for each
+/// strength level. The offset is in pixels of the texture being sampled.
+static const struct {
+	int iterations;
+	float offset;
+} dual_kawase_strength_levels[] = {
+    {1, 1.25f}, {1, 2.25f}, {2, 2.00f}, {2, 3.00f}, {2, 4.25f},
+    {3, 2.50f}, {3, 3.25f}, {3, 4.25f}, {3, 5.50f}, {4, 3.25f},
+    {4, 4.00f}, {4, 5.00f}, {4, 6.00f}, {4, 7.25f}, {4, 8.25f},
+    {5, 4.50f}, {5, 5.25f}, {5, 6.25f}, {5, 7.25f}, {5, 8.50f},
+};
+
+/// Approximate visual strength of the dual_kawase blur, as a radius in screen pixels.
+/// Only used to pick a strength level for a blur radius, see dual_kawase_radius for how
+/// far the blur actually reads.
+static inline int dual_kawase_spread(int iterations, float offset) {
+	return (int)ceilf((float)(1 << iterations) * offset);
+}
+
+/// How far, in screen pixels, the dual_kawase blur reads from the pixel it computes.
+///
+/// The pass down from level `i` and the pass up to it sample texels of levels `i` and
+/// `i + 1`, which are 2^i and 2^(i+1) screen pixels wide, `offset` texels away. Linear
+/// filtering reaches one texel further.
+static inline int dual_kawase_radius(int iterations, float offset) {
+	float radius = 0;
+	for (int i = 0; i < iterations; i++) {
+		radius += (offset + 1) * (float)((1 << i) + (2 << i));
+	}
+	return (int)ceilf(radius);
+}
+
+/// Get the dual_kawase blur parameters for the given arguments.
+static void dual_kawase_params(const struct dual_kawase_blur_args *args,
+                               int *iterations, float *offset) {
+	int nlevels = (int)ARR_SIZE(dual_kawase_strength_levels);
+	int strength = args->strength;
+	if (strength < 1 && args->size > 0) {
+		// Pick the strongest level that stays within the requested radius
+		strength = 1;
+		for (int i = 0; i < nlevels; i++) {
+			if (dual_kawase_spread(dual_kawase_strength_levels[i].iterations,
+			                       dual_kawase_strength_levels[i].offset) <=
+			    args->size) {
+				strength = i + 1;
+			}
+		}
+	} else if (strength < 1) {
+		strength = 5;
+	}
+	strength = min2(strength, nlevels);
+	*iterations = dual_kawase_strength_levels[strength - 1].iterations;
+	*offset = dual_kawase_strength_levels[strength - 1].offset;
+	assert(*iterations <= DUAL_KAWASE_MAX_ITERATIONS);
+}
+
+/// Split the separable kernels in `kernels` into a horizontal and a vertical pass,
+/// which takes 2N instead of N^2 samples per pixel for a N x N kernel. The other
+/// kernels are copied as is. Returns a new array of newly allocated kernels.
+static struct conv **
+split_separable_kernels(struct conv **kernels, int kernel_count, int *ret_count) {
+	auto ret = ccalloc(kernel_count * 2, struct conv *);
+	int n = 0;
+	for (int i = 0; i < kernel_count; i++) {
+		if (split_separable_kernel(kernels[i], &ret[n], &ret[n + 1])) {
+			n += 2;
+			continue;
+		}
+		size_t size = sizeof(struct conv) +
+		              (size_t)(kernels[i]->w * kernels[i]->h) * sizeof(double);
+		ret[n] = cvalloc(size);
+		memcpy(ret[n], kernels[i], size);
+		ret[n]->rsum = NULL;
+		n++;
+	}
+	*ret_count = n;
+	return ret;
+}
@@ -12,6 +12,9 @@ OPTION(c2_lptr_t*,       background_blacklist, cfg_type_pointer,     NULL)
 OPTION(enum blur_method, method,               cfg_type_blur_method, BLUR_METHOD_NONE)
 /// Size of the blur kernel (gaussian blur + box blur)
 OPTION(int,              radius,               cfg_type_int,         -1)
+/// Strength of the dual_kawase blur, from 1 to 20. Derived from `radius` when
+/// not set.
+OPTION(int,              strength,             cfg_type_int,         -1)
 /// Standard deviation (gaussian blur)
 OPTION(double,           deviation,            cfg_type_float,       0.84089642)
 /// Blur convolution kernel (kernel blur).
@@ -46,6 +46,34 @@ struct window_properties {
 #undef OPTION
 } winprop;
 
+/// Blurred background of a window, reused as long as nothing below the window changes
+struct blur_cache {
+	/// Backend specific storage of the blurred background, NULL if nothing is cached
+	void *data;
+	/// Area of the screen covered by the cache
+	int x, y, width, height;
+	/// Opacity the background was blurred with
+	double opacity;
+	/// Part of the cache that holds the current blurred background, in global
+	/// coordinates
+	region_t reg_valid;
+};
+
+struct window_data {
+	struct window_options options;
+	struct blur_cache cache;
+};
+
+static inline struct window_options *win_options(module_t *module, struct managed_win *w) {
+	struct window_data *wd = win_get_windata(w, module->windata_cookie);
+	return &wd->options;
+}
+
+static inline struct blur_cache *win_blur_cache(module_t *module, struct managed_win *w) {
+	struct window_data *wd = win_get_windata(w, module->windata_cookie);
+	return &wd->cache;
+}
+
 static void *backend_create_blur_context(module_t *module, session_t *ps, backend_t *base, enum blur_method blur_method, void *args) {
 	UNUSED(module);
 
@@ -101,10 +129,113 @@ static void backend_get_blur_size(module_t *module, session_t *ps, void *blur_co
 	}
 }
 
+static void *backend_blur_cache_new(module_t *module, session_t *ps, backend_t *base, int width, int height) {
+	UNUSED(module);
+
+	switch (ps->o.backend) {
+	case BKEND_XRENDER:
+		return xrender_blur_cache_new(base, width, height);
+	case BKEND_GLX:
+		return gl_blur_cache_new(base, width, height);
+	default:
+		return NULL;
+	}
+}
+static void backend_blur_cache_free(module_t *module, session_t *ps, backend_t *base, void *cache) {
+	UNUSED(module);
+
+	switch (ps->o.backend) {
+	case BKEND_XRENDER:
+		xrender_blur_cache_free(base, cache);
+		break;
+	case BKEND_GLX:
+		gl_blur_cache_free(base, cache);
+		break;
+	default:
+		break;
+	}
+}
+/// Copy `reg` of the rendering buffer into `cache`, whose top left corner is at (x, y)
+static void backend_blur_cache_save(module_t *module, session_t *ps, backend_t *base, void *cache,
+	        int x, int y, const region_t *reg) {
+	UNUSED(module);
+
+	switch (ps->o.backend) {
+	case BKEND_XRENDER:
+		xrender_blur_cache_save(base, cache, x, y, reg);
+		break;
+	case BKEND_GLX:
+		gl_blur_cache_save(base, cache, x, y, reg);
+		break;
+	default:
+		break;
+	}
+}
+/// Copy `reg` of `cache`, whose top left corner is at (x, y), back into the rendering buffer
+static void backend_blur_cache_restore(module_t *module, session_t *ps, backend_t *base, void *cache,
+	        int x, int y, const region_t *reg) {
+	UNUSED(module);
+
+	switch (ps->o.backend) {
+	case BKEND_XRENDER:
+		xrender_blur_cache_restore(base, cache, x, y, reg);
+		break;
+	case BKEND_GLX:
+		gl_blur_cache_restore(base, cache, x, y, reg);
+		break;
+	default:
+		break;
+	}
+}
+
+static void blur_cache_release(module_t *module, session_t *ps, struct blur_cache *cache) {
+	if (cache->data) {
+		backend_blur_cache_free(module, ps, ps->backend_data, cache->data);
+		cache->data = NULL;
+	}
+	pixman_region32_fini(&cache->reg_valid);
+	pixman_region32_init(&cache->reg_valid);
+}
+
+/// Opacity the background of `w` is blurred with
+static double win_blur_opacity(session_t *ps, struct managed_win *w) {
+	double blur_opacity = 1;
+	if (w->state == WSTATE_MAPPING) {
+		// Gradually increase the blur intensity during
+		// fading in.
+		blur_opacity = w->opacity * w->opacity_target;
+	} else if (w->state == WSTATE_UNMAPPING ||
+	           w->state == WSTATE_DESTROYING) {
+		// Gradually decrease the blur intensity during
+		// fading out.
+		blur_opacity =
+		    w->opacity * win_calc_opacity_target(ps, w, true);
+	}
+
+	pedantic_assert(blur_opacity >= 0 && blur_opacity <= 1);
+	return blur_opacity;
+}
+
+/// Get the blur cache of `w` if its content can be used in this frame, NULL otherwise
+static struct blur_cache *win_get_usable_blur_cache(module_t *module, session_t *ps,
+	        struct managed_win *w) {
+	auto cache = win_blur_cache(module, w);
+	// Blur opacity changes every frame while fading, don't bother
+	if (!cache->data || w->state != WSTATE_MAPPED) {
+		return NULL;
+	}
+	if (cache->x != w->g.x || cache->y != w->g.y || cache->width != w->widthb ||
+	    cache->height != w->heightb || cache->opacity != win_blur_opacity(ps, w)) {
+		return NULL;
+	}
+	return cache;
+}
+
 static bool initialize_blur(module_t *module, session_t *ps) {
 	struct kernel_blur_args kargs;
 	struct gaussian_blur_args gargs;
 	struct box_blur_args bargs;
+	struct dual_kawase_blur_args dargs;
 
 	void *args = NULL;
 	switch (options.method) {
@@ -122,6 +253,11 @@ static bool initialize_blur(module_t *module, session_t *ps) {
 		gargs.deviation = options.deviation;
 		args = (void *)&gargs;
 		break;
+	case BLUR_METHOD_DUAL_KAWASE:
+		dargs.size = options.radius;
+		dargs.strength = options.strength;
+		args = (void *)&dargs;
+		break;
 	default: return true;
 	}
 
@@ -136,6 +272,7 @@ static int backend_init(modev_t evid, module_t *module, session_t *ps, void *ud)
 
 	if (!initialize_blur(module, ps)) {
 		log_fatal("Failed to prepare for background blur, aborting...");
+		backend_clear_shadow_cache(ps->backend_data);
 		ps->backend_data->ops->deinit(ps->backend_data);
 		ps->backend_data = NULL;
 		quit(ps);
@@ -159,6 +296,9 @@ static int backend_deinit(modev_t evid, module_t *module, session_t *ps, void *u
 		}
 		free(ps->psglx->blur_passes);
 	}
+	win_stack_foreach_managed(w, &ps->window_stack) {
+		blur_cache_release(module, ps, win_blur_cache(module, w));
+	}
 	if (ps->backend_blur_context) {
 		backend_destroy_blur_context(module, ps,
 		     ps->backend_data, ps->backend_blur_context);
@@ -167,9 +307,34 @@ static int backend_deinit(modev_t evid, module_t *module, session_t *ps, void *u
 
 	return 0;
 }
+/// Whether the background of `w` will be blurred
+static bool win_blurs_background(session_t *ps, module_t *module, struct managed_win *w) {
+	struct window_options *winoptions = win_options(module, w);
+
+	// TODO since the background might change the content of the window (e.g.
+	//      with shaders), we should consult the background whether the window
+	//      is transparent or not. for now we will just rely on the
+	//      force_win_blend option
+	auto real_win_mode = w->mode;
+	return winoptions->blur_background &&
+	       (ps->o.force_win_blend || real_win_mode == WMODE_TRANS ||
+	        (options.background_frame && real_win_mode == WMODE_FRAME_TRANS));
+}
+
+/// Get the region of the screen where `w` blurs its background, in global coordinates.
+/// The window must blur its background.
+static region_t win_get_blur_region_by_val(session_t *ps, struct managed_win *w) {
+	if (w->mode == WMODE_TRANS || ps->o.force_win_blend) {
+		return win_get_bounding_shape_global_by_val(w);
+	}
+	// Window itself is solid, only the frame is blurred
+	region_t reg_blur = win_get_region_frame_local_by_val(w);
+	pixman_region32_translate(&reg_blur, w->g.x, w->g.y);
+	return reg_blur;
+}
+
 static int prepare(modev_t evid, module_t *module, session_t *ps, void *ud) {
 	UNUSED(evid);
-	UNUSED(module);
 
 	struct managed_win *bottom_window = ud; // TODO: Create struct paint_pass_data to allow sharing more than just this
 
@@ -183,87 +348,150 @@ static int prepare(modev_t evid, module_t *module, session_t *ps, void *ud) {
 	// region, that won't be cleared by the next render, and will thus accumulate.
 	// (e.g. if shadow is drawn outside the damaged region, it will become thicker and
 	// thicker over time.)
-	//
-	// Really this solution is suboptimal, we should really just calculate the actual
-	// damaged region, but this is much simpler to implement and sufficient when not using
-	// custom shaders and only using a single blur filter at a time.
 
 	assert(options.method != BLUR_METHOD_INVALID);
-	if (options.method != BLUR_METHOD_NONE) {
-		int blur_width, blur_height;
-		backend_get_blur_size(module, ps, ps->backend_blur_context,
-		                                     &blur_width, &blur_height);
-
-		// The region of screen a given window influences will be smeared
-		// out by blur. With more windows on top of the given window, the
-		// influences region will be smeared out more.
-		//
-		// Also, blurring requires data slightly outside the area that needs
-		// to be blurred. The more semi-transparent windows are stacked on top
-		// of each other, the larger the area will be.
-		//
-		// Instead of accurately calculate how much bigger the damage
-		// region will be because of blur, we assume the worst case here.
-		// That is, the damaged window is at the bottom of the stack, and
-		// all other windows have semi-transparent background
-		int resize_factor = 1;
-		if (bottom_window) {
-			resize_factor = bottom_window->stacking_rank;
-		}
-		resize_region_in_place(&ps->reg_damage, blur_width * resize_factor,
-		                       blur_height * resize_factor);
-		// FIXME: I am pretty sure it doesn't need to do both of these? ^ v
-		ps->reg_paint = resize_region(&ps->reg_damage, blur_width * resize_factor,
-		                          blur_height * resize_factor);
-		pixman_region32_intersect(&ps->reg_paint, &ps->reg_paint, &ps->screen_reg);
-		pixman_region32_intersect(&ps->reg_damage, &ps->reg_damage, &ps->screen_reg);
-	} else {
-		pixman_region32_init(&ps->reg_paint);
+	pixman_region32_init(&ps->reg_paint);
+	if (options.method == BLUR_METHOD_NONE) {
 		pixman_region32_copy(&ps->reg_paint, &ps->reg_damage);
+		return 0;
 	}
+
+	int blur_width, blur_height;
+	backend_get_blur_size(module, ps, ps->backend_blur_context, &blur_width,
+	                      &blur_height);
+
+	// The region of screen a given window influences will be smeared out by the
+	// blur of every window above it that blurs its background. So walk the windows
+	// from bottom to top, and grow the damage through the blur regions of the
+	// windows it reaches.
+	//
+	// The damage region doesn't record which window it comes from, so damage
+	// from a window is also assumed to affect the windows below it. This only
+	// overestimates the damage. Parts of the blurred background restored from the
+	// blur cache don't change.
+	struct blurred_win {
+		region_t reg_blur;
+		const region_t *reg_cached;
+	} *blurred = NULL;
+	int nblurred = 0, capacity = 0;
+	region_t reg_tmp;
+	pixman_region32_init(&reg_tmp);
+	for (auto w = bottom_window; w; w = w->prev_trans) {
+		if (!win_blurs_background(ps, module, w)) {
+			continue;
+		}
+		if (nblurred == capacity) {
+			capacity = max2(capacity * 2, 8);
+			blurred = crealloc(blurred, capacity);
+		}
+		auto cache = win_get_usable_blur_cache(module, ps, w);
+		auto curr = &blurred[nblurred++];
+		curr->reg_blur = win_get_blur_region_by_val(ps, w);
+		curr->reg_cached = cache ? &cache->reg_valid : NULL;
+
+		_resize_region(&ps->reg_damage, &reg_tmp, blur_width, blur_height);
+		pixman_region32_intersect(&reg_tmp, &reg_tmp, &curr->reg_blur);
+		if (curr->reg_cached) {
+			pixman_region32_subtract(&reg_tmp, &reg_tmp, (region_t *)curr->reg_cached);
+		}
+		pixman_region32_union(&ps->reg_damage, &ps->reg_damage, &reg_tmp);
+	}
+	pixman_region32_intersect(&ps->reg_damage, &ps->reg_damage, &ps->screen_reg);
+
+	// Blurring requires data slightly outside the area that needs to be blurred,
+	// so the area below the blurred part of a window has to be painted too. That
+	// area can in turn be blurred by windows further below, so this time walk the
+	// windows from top to bottom.
+	pixman_region32_copy(&ps->reg_paint, &ps->reg_damage);
+	for (int i = nblurred - 1; i >= 0; i--) {
+		pixman_region32_intersect(&reg_tmp, &blurred[i].reg_blur, &ps->reg_paint);
+		if (blurred[i].reg_cached) {
+			pixman_region32_subtract(&reg_tmp, &reg_tmp,
+			                         (region_t *)blurred[i].reg_cached);
+		}
+		if (pixman_region32_not_empty(&reg_tmp)) {
+			resize_region_in_place(&reg_tmp, blur_width, blur_height);
+			pixman_region32_union(&ps->reg_paint, &ps->reg_paint, &reg_tmp);
+		}
+		pixman_region32_fini(&blurred[i].reg_blur);
+	}
+	free(blurred);
+	pixman_region32_fini(&reg_tmp);
+	pixman_region32_intersect(&ps->reg_paint, &ps->reg_paint, &ps->screen_reg);
 	return 0;
 }
+/// Blur `reg_blur` of the background of `w`, reusing the blur cache of the window where
+/// it is still valid.
+static void blur_win_background(module_t *module, session_t *ps, struct managed_win *w,
+	        double opacity, const region_t *reg_blur) {
+	if (w->state != WSTATE_MAPPED) {
+		backend_blur(module, ps, ps->backend_data, opacity,
+		             ps->backend_blur_context, reg_blur, &ps->reg_visible);
+		return;
+	}
+
+	auto cache = win_blur_cache(module, w);
+	if (!win_get_usable_blur_cache(module, ps, w)) {
+		blur_cache_release(module, ps, cache);
+		cache->data = backend_blur_cache_new(module, ps, ps->backend_data,
+		                                     w->widthb, w->heightb);
+		cache->x = w->g.x;
+		cache->y = w->g.y;
+		cache->width = w->widthb;
+		cache->height = w->heightb;
+		cache->opacity = opacity;
+		if (!cache->data) {
+			backend_blur(module, ps, ps->backend_data, opacity,
+			             ps->backend_blur_context, reg_blur, &ps->reg_visible);
+			return;
+		}
+	}
+
+	region_t reg_missing, reg_cached;
+	pixman_region32_init(&reg_missing);
+	pixman_region32_init(&reg_cached);
+	pixman_region32_intersect(&reg_missing, (region_t *)reg_blur, &ps->reg_visible);
+	pixman_region32_intersect_rect(&reg_missing, &reg_missing, cache->x, cache->y,
+	                               (unsigned)cache->width, (unsigned)cache->height);
+	pixman_region32_intersect(&reg_cached, &reg_missing, &cache->reg_valid);
+	pixman_region32_subtract(&reg_missing, &reg_missing, &cache->reg_valid);
+
+	// Blur first, the blur needs the unblurred background around the blurred
+	// region, some of which might be replaced by the cached content.
+	if (pixman_region32_not_empty(&reg_missing) &&
+	    backend_blur(module, ps, ps->backend_data, opacity, ps->backend_blur_context,
+	                 &reg_missing, &ps->reg_visible)) {
+		backend_blur_cache_save(module, ps, ps->backend_data, cache->data,
+		                        cache->x, cache->y, &reg_missing);
+		pixman_region32_union(&cache->reg_valid, &cache->reg_valid, &reg_missing);
+	}
+	if (pixman_region32_not_empty(&reg_cached)) {
+		backend_blur_cache_restore(module, ps, ps->backend_data, cache->data,
+		                           cache->x, cache->y, &reg_cached);
+	}
+	pixman_region32_fini(&reg_missing);
+	pixman_region32_fini(&reg_cached);
+}
+
 static int blur(modev_t evid, module_t *module, session_t *ps, void *ud) {
 	UNUSED(evid);
-	UNUSED(module);
 
 	struct managed_win *w = ud;
-	struct window_options *winoptions = win_get_windata(w, module->windata_cookie);
 
 	// Blur window background
-	// TODO since the background might change the content of the window (e.g.
-	//      with shaders), we should consult the background whether the window
-	//      is transparent or not. for now we will just rely on the
-	//      force_win_blend option
 	auto real_win_mode = w->mode;
 
-	if (winoptions->blur_background &&
-	    (ps->o.force_win_blend || real_win_mode == WMODE_TRANS ||
-	     (options.background_frame && real_win_mode == WMODE_FRAME_TRANS))) {
+	if (win_blurs_background(ps, module, w)) {
 		// Minimize the region we try to blur, if the window
 		// itself is not opaque, only the frame is.
 
-		double blur_opacity = 1;
-		if (w->state == WSTATE_MAPPING) {
-			// Gradually increase the blur intensity during
-			// fading in.
-			blur_opacity = w->opacity * w->opacity_target;
-		} else if (w->state == WSTATE_UNMAPPING ||
-		           w->state == WSTATE_DESTROYING) {
-			// Gradually decrease the blur intensity during
-			// fading out.
-			blur_opacity =
-			    w->opacity * win_calc_opacity_target(ps, w, true);
-		}
-
-		pedantic_assert(blur_opacity >= 0 && blur_opacity <= 1);
+		double blur_opacity = win_blur_opacity(ps, w);
 
 		if (real_win_mode == WMODE_TRANS || ps->o.force_win_blend) {
 			// We need to blur the bounding shape of the window
 			// (reg_paint_in_bound = reg_bound \cap reg_paint)
-			backend_blur(module, ps, 
-			    ps->backend_data, blur_opacity, ps->backend_blur_context,
-			    &w->reg_paint_in_bound, &ps->reg_visible);
+			blur_win_background(module, ps, w, blur_opacity,
+			                    &w->reg_paint_in_bound);
 		} else {
 			// Window itself is solid, we only need to blur the frame
 			// region
@@ -272,8 +500,7 @@ static int blur(modev_t evid, module_t *module, session_t *ps, void *ud) {
 			assert(options.background_frame);
 			assert(real_win_mode == WMODE_FRAME_TRANS);
 
-			region_t reg_blur = win_get_region_frame_local_by_val(w);
-			pixman_region32_translate(&reg_blur, w->g.x, w->g.y);
+			region_t reg_blur = win_get_blur_region_by_val(ps, w);
 			// make sure reg_blur \in reg_paint
 			pixman_region32_intersect(&reg_blur, &reg_blur, &ps->reg_paint);
 			if (ps->o.transparent_clipping) {
@@ -281,14 +508,82 @@ static int blur(modev_t evid, module_t *module, session_t *ps, void *ud) {
 				pixman_region32_intersect(&reg_blur, &reg_blur,
 				                          &ps->reg_visible);
 			}
-			backend_blur(module, ps, ps->backend_data, blur_opacity,
-			                            ps->backend_blur_context,
-			                            &reg_blur, &ps->reg_visible);
+			blur_win_background(module, ps, w, blur_opacity, &reg_blur);
 			pixman_region32_fini(&reg_blur);
 		}
 	}
 	return 0;
 }
+/// Drop the cached blurred background of windows that can see the damage through their
+/// blur
+static int ondamage(modev_t evid, module_t *module, session_t *ps, void *ud) {
+	UNUSED(evid);
+
+	struct modev_damage *ev = ud;
+	if (!ps->backend_data || !ps->backend_blur_context) {
+		return 0;
+	}
+
+	// Windows from ev->w down are not above the window whose content changed,
+	// their backgrounds are unaffected.
+	struct managed_win **above = NULL;
+	int nabove = 0, capacity = 0;
+	win_stack_foreach_managed(w, &ps->window_stack) {
+		if (w == ev->w) {
+			break;
+		}
+		if (nabove == capacity) {
+			capacity = max2(capacity * 2, 8);
+			above = crealloc(above, capacity);
+		}
+		above[nabove++] = w;
+	}
+
+	// A window that blurs its background spreads the damage below it over its
+	// blur region, which the blur of the windows above it spreads further. So walk
+	// from bottom to top, and grow the affected region like prepare does.
+	int blur_width, blur_height;
+	backend_get_blur_size(module, ps, ps->backend_blur_context, &blur_width,
+	                      &blur_height);
+	region_t reg_affected, reg_resized;
+	pixman_region32_init(&reg_affected);
+	pixman_region32_init(&reg_resized);
+	pixman_region32_copy(&reg_affected, (region_t *)ev->damage);
+	for (int i = nabove - 1; i >= 0; i--) {
+		auto w = above[i];
+		_resize_region(&reg_affected, &reg_resized, blur_width, blur_height);
+		auto cache = win_blur_cache(module, w);
+		if (cache->data) {
+			pixman_region32_subtract(&cache->reg_valid, &cache->reg_valid,
+			                         &reg_resized);
+		}
+		if (win_blurs_background(ps, module, w)) {
+			auto reg_blur = win_get_blur_region_by_val(ps, w);
+			pixman_region32_intersect(&reg_resized, &reg_resized, &reg_blur);
+			pixman_region32_union(&reg_affected, &reg_affected, &reg_resized);
+			pixman_region32_fini(&reg_blur);
+		}
+	}
+	free(above);
+	pixman_region32_fini(&reg_affected);
+	pixman_region32_fini(&reg_resized);
+	return 0;
+}
+static int onwinadded(modev_t evid, module_t *module, session_t *ps, void *ud) {
+	UNUSED(evid);
+	UNUSED(ps);
+
+	struct window_data *wd = win_get_windata(ud, module->windata_cookie);
+	memset(wd, 0, sizeof(*wd));
+	pixman_region32_init(&wd->cache.reg_valid);
+	return 0;
+}
+static int onwinunmapped(modev_t evid, module_t *module, session_t *ps, void *ud) {
+	UNUSED(evid);
+
+	blur_cache_release(module, ps, win_blur_cache(module, ud));
+	return 0;
+}
 static int onexit(modev_t evid, module_t *module, session_t *ps, void *ud) {
 	UNUSED(evid);
 	UNUSED(module);
@@ -303,7 +598,7 @@ static int onexit(modev_t evid, module_t *module, session_t *ps, void *ud) {
 }
 static void
 set_blur_background(session_t *ps, module_t *module, struct managed_win *w, bool blur_background_new) {
-	struct window_options *winoptions = win_get_windata(w, module->windata_cookie);
+	struct window_options *winoptions = win_options(module, w);
 
 	if (winoptions->blur_background == blur_background_new)
 		return;
@@ -333,11 +628,11 @@ static int onwinchanged(modev_t evid, module_t *module, session_t *ps, void *ud)
 	UNUSED(evid);
 	UNUSED(module);
 
-	struct managed_win *w = ud;
+	struct modev_win_changed *ev = ud;
 
-	c2_lptr_t *blur_background_blacklist = options.background_blacklist;
-	if (blur_background_blacklist)
-		determine_blur_background(ps, module, w);
+	// The blacklist only has to be matched again if something it depends on changed
+	if (ev->changed & c2_list_get_deps(options.background_blacklist))
+		determine_blur_background(ps, module, ev->w);
 	return 0;
 }
 static int onwinmapped(modev_t evid, module_t *module, session_t *ps, void *ud) {
@@ -351,10 +646,12 @@ static int onwinmapped(modev_t evid, module_t *module, session_t *ps, void *ud)
 	return 0;
 }
 static int load(session_t *ps, module_t *module, void *ud) {
-	UNUSED(ps);
-	UNUSED(module);
 	UNUSED(ud);
 
+	if (module_reserve_windowdata(ps, module, sizeof(struct window_data)) < 0) {
+		return -1;
+	}
+
 	module->options = &options;
 #define OPTION(...) MODULE_ADD_OPTION(prop, &module->cfg_module, &options, __VA_ARGS__)
 #include "cfg_mod.h"
@@ -370,6 +667,10 @@ static int load(session_t *ps, module_t *module, void *ud) {
 	module_subscribe(module, MODEV_EXIT, onexit);
 	module_subscribe(module, MODEV_WIN_CHANGED, onwinchanged);
 	module_subscribe(module, MODEV_WIN_MAPPED, onwinmapped);
+	module_subscribe(module, MODEV_WIN_ADDED, onwinadded);
+	module_subscribe(module, MODEV_WIN_UNMAPPED, onwinunmapped);
+	module_subscribe(module, MODEV_WIN_DESTROYED, onwinunmapped);
+	module_subscribe(module, MODEV_DAMAGE, ondamage);
 
 	return 0;
 }
@@ -378,3 +679,17 @@ modinfo_t modinfo_blur = {
 	.load = load,
 	.unload = NULL,
 };
+
+TEST_CASE(dual_kawase_radius) {
+	// Strength levels 1, 5, 10 and 20
+	const int levels[] = {0, 4, 9, 19};
+	const int radii[] = {7, 48, 192, 884};
+	for (int i = 0; i < (int)ARR_SIZE(levels); i++) {
+		auto level = &dual_kawase_strength_levels[levels[i]];
+		int radius = dual_kawase_radius(level->iterations, level->offset);
+		TEST_EQUAL(radius, radii[i]);
+		// At least as far as the sample offsets reach, without filtering
+		TEST_TRUE((float)radius >=
+		          3 * level->offset * (float)((1 << level->iterations) - 1));
+	}
+}
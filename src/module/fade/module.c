@@ -1,9 +1,95 @@
 #include "module.h"
+#include "picom.h"
+
+static inline double get_time_ms_precise(void) {
+	auto now = get_time_timespec();
+	return (double)now.tv_sec * 1000.0 + (double)now.tv_nsec / 1000000.0;
+}
+
+/**
+ * Run fading on a window.
+ *
+ * @param steps fading steps since the last frame, can be fractional
+ * @return whether we are still in fading mode
+ */
+static bool run_fade(session_t *ps, struct managed_win *w, double steps) {
+	if (w->state == WSTATE_MAPPED || w->state == WSTATE_UNMAPPED) {
+		// We are not fading
+		assert(w->opacity_target == w->opacity);
+		return false;
+	}
+
+	if (!win_should_fade(ps, w)) {
+		log_debug("Window %#010x %s doesn't need fading", w->base.id, w->name);
+		w->opacity = w->opacity_target;
+	}
+	if (w->opacity == w->opacity_target) {
+		// We have reached target opacity.
+		// We don't call win_check_fade_finished here because that could destroy
+		// the window, but we still need the damage info from this window
+		log_debug("Fading finished for window %#010x %s", w->base.id, w->name);
+		return false;
+	}
+
+	if (w->opacity < w->opacity_target) {
+		w->opacity = clamp(w->opacity + ps->o.fade_in_step * steps, 0.0,
+		                   w->opacity_target);
+	} else {
+		w->opacity =
+		    clamp(w->opacity - ps->o.fade_out_step * steps, w->opacity_target, 1);
+	}
+
+	// Note even if opacity == opacity_target here, we still want to run preprocess
+	// one last time to finish state transition. So return true in that case too.
+	return true;
+}
+
+/// Advance the opacity of fading windows by the time passed since the last frame.
+///
+/// Fade steps are defined per fade_delta milliseconds. Interpolating them from the
+/// frame time lets fading run at the rate frames are actually presented, slower
+/// displays just see bigger steps.
+static int paint_start(modev_t evid, module_t *module, session_t *ps, void *ud) {
+	UNUSED(evid);
+	UNUSED(module);
+
+	struct modev_paint_start *ev = ud;
+	double now = get_time_ms_precise();
+	double steps = 0;
+	if (ps->fade_time != 0) {
+		assert(now >= ps->fade_time);
+		steps = (now - ps->fade_time) / ps->o.fade_delta;
+	}
+	ps->fade_time = now;
+
+	bool fade_running = false;
+	win_stack_foreach_managed(w, &ps->window_stack) {
+		const double opacity_old = w->opacity;
+		if (run_fade(ps, w, steps)) {
+			fade_running = true;
+		}
+
+		// Add window to damaged area if its opacity changes
+		// If the window wasn't painted, damage will be added by paint_preprocess
+		// if it will be painted now
+		if (w->to_paint && w->opacity != opacity_old) {
+			add_damage_from_win(ps, w);
+		}
+	}
+
+	if (fade_running) {
+		ev->animating = true;
+	} else {
+		ps->fade_time = 0;
+	}
+	return 0;
+}
 
 static int load(session_t *ps, module_t *module, void *ud) {
 	UNUSED(ps);
-	UNUSED(module);
 	UNUSED(ud);
+
+	module_subscribe(module, MODEV_STAGE_PAINT_START, paint_start);
 	return 0;
 }
 modinfo_t modinfo_fade = {
@@ -1,9 +1,154 @@
 #include "module.h"
+#include "backend/backend.h"
+#include "backend/backend_common.h"
 
-static int load(session_t *ps, module_t *module, void *ud) {
+struct window_data {
+	/// Whether the shadow was already painted with the batch of this frame
+	bool shadow_batched;
+};
+
+static inline struct window_data *win_data(module_t *module, struct managed_win *w) {
+	return win_get_windata(w, module->windata_cookie);
+}
+
+/// Get the part of the screen where the shadow of `w` is painted, in global coordinates.
+///
+/// @param reg_bound   the bounding shape of the window, in global coordinates
+/// @param reg_visible the part of the screen not covered by the windows above `w`
+static region_t win_get_shadow_paint_region_by_val(session_t *ps, struct managed_win *w,
+                                                   const region_t *reg_bound,
+                                                   const region_t *reg_visible) {
+	// reg_shadow \in reg_paint
+	auto reg_shadow = win_extents_by_val(w);
+	pixman_region32_intersect(&reg_shadow, &reg_shadow, &ps->reg_paint);
+	if (!ps->o.wintype_option[w->window_type].full_shadow) {
+		pixman_region32_subtract(&reg_shadow, &reg_shadow, (region_t *)reg_bound);
+	}
+
+	// Mask out the region we don't want shadow on
+	if (pixman_region32_not_empty(&ps->shadow_exclude_reg)) {
+		pixman_region32_subtract(&reg_shadow, &reg_shadow, &ps->shadow_exclude_reg);
+	}
+
+	if (ps->o.xinerama_shadow_crop && w->xinerama_scr >= 0 &&
+	    w->xinerama_scr < ps->xinerama_nscrs) {
+		// There can be a window where number of screens is updated, but the
+		// screen number attached to the windows have not.
+		//
+		// Window screen number will be updated eventually, so here we just check
+		// to make sure we don't access out of bounds.
+		pixman_region32_intersect(&reg_shadow, &reg_shadow,
+		                          &ps->xinerama_scr_regs[w->xinerama_scr]);
+	}
+
+	if (ps->o.transparent_clipping) {
+		// ref: <transparent-clipping-note>
+		pixman_region32_intersect(&reg_shadow, &reg_shadow, (region_t *)reg_visible);
+	}
+	return reg_shadow;
+}
+
+/// Paint, in one batch, the shadows that nothing below them will be painted over.
+///
+/// Shadows all have the same color, so the order they are painted in doesn't matter
+/// among themselves. A shadow only has to wait for its window's turn if it overlaps the
+/// body of a window below it.
+static int paint_batch(modev_t evid, module_t *module, session_t *ps, void *ud) {
+	UNUSED(evid);
+
+	struct managed_win *bottom_window = ud;
+	// Background blur reads the screen around the windows below, which a shadow
+	// painted early would leak into. Paint every shadow in order then.
+	bool can_batch = !ps->backend_blur_context;
+
+	struct backend_compose_item *items = NULL;
+	int nitems = 0, capacity = 0;
+	region_t reg_below, reg_visible, reg_overlap;
+	pixman_region32_init(&reg_below);
+	pixman_region32_init(&reg_visible);
+	pixman_region32_init(&reg_overlap);
+	for (auto w = bottom_window; w; w = w->prev_trans) {
+		win_data(module, w)->shadow_batched = false;
+		if (!can_batch) {
+			continue;
+		}
+
+		auto reg_bound = win_get_bounding_shape_global_by_val(w);
+		if (w->shadow) {
+			pixman_region32_subtract(&reg_visible, &ps->screen_reg, w->reg_ignore);
+			auto reg_shadow = win_get_shadow_paint_region_by_val(
+			    ps, w, &reg_bound, &reg_visible);
+			// compose clips to the visible region of the window, which differs
+			// between the windows of the batch.
+			pixman_region32_intersect(&reg_shadow, &reg_shadow, &reg_visible);
+
+			pixman_region32_intersect(&reg_overlap, &reg_shadow, &reg_below);
+			if (!pixman_region32_not_empty(&reg_overlap)) {
+				if (capacity - nitems < BACKEND_SHADOW_MAX_ITEMS) {
+					capacity = max2(capacity * 2, BACKEND_SHADOW_MAX_ITEMS * 4);
+					items = crealloc(items, capacity);
+				}
+				nitems += backend_shadow_compose_items(
+				    w->shadow_image, w->opacity, w->g.x + w->shadow_dx,
+				    w->g.y + w->shadow_dy, w->widthb, w->heightb, &reg_shadow,
+				    &items[nitems]);
+				win_data(module, w)->shadow_batched = true;
+			}
+			pixman_region32_fini(&reg_shadow);
+		}
+		pixman_region32_union(&reg_below, &reg_below, &reg_bound);
+		pixman_region32_fini(&reg_bound);
+	}
+
+	backend_compose_batch(ps->backend_data, items, nitems, &ps->screen_reg);
+	for (int i = 0; i < nitems; i++) {
+		pixman_region32_fini(&items[i].reg_paint);
+	}
+	free(items);
+	pixman_region32_fini(&reg_below);
+	pixman_region32_fini(&reg_visible);
+	pixman_region32_fini(&reg_overlap);
+	return 0;
+}
+
+/// Paint the shadow of a window that couldn't be batched
+static int paint_shadow(modev_t evid, module_t *module, session_t *ps, void *ud) {
+	UNUSED(evid);
+
+	struct managed_win *w = ud;
+	if (!w->shadow || win_data(module, w)->shadow_batched) {
+		return 0;
+	}
+
+	assert(!(w->flags & WIN_FLAGS_SHADOW_NONE));
+	assert(w->shadow_image);
+	auto reg_shadow =
+	    win_get_shadow_paint_region_by_val(ps, w, &w->reg_bound, &ps->reg_visible);
+	backend_compose_shadow(ps->backend_data, w->shadow_image, w->opacity,
+	                       w->g.x + w->shadow_dx, w->g.y + w->shadow_dy, w->widthb,
+	                       w->heightb, &reg_shadow, &ps->reg_visible);
+	pixman_region32_fini(&reg_shadow);
+	return 0;
+}
+
+static int onwinadded(modev_t evid, module_t *module, session_t *ps, void *ud) {
+	UNUSED(evid);
 	UNUSED(ps);
-	UNUSED(module);
+
+	win_data(module, ud)->shadow_batched = false;
+	return 0;
+}
+
+static int load(session_t *ps, module_t *module, void *ud) {
 	UNUSED(ud);
+
+	if (module_reserve_windowdata(ps, module, sizeof(struct window_data)) < 0) {
+		return -1;
+	}
+
+	module_subscribe(module, MODEV_STAGE_SCREEN_SHADOW, paint_batch);
+	module_subscribe(module, MODEV_STAGE_WIN_SHADOW, paint_shadow);
+	module_subscribe(module, MODEV_WIN_ADDED, onwinadded);
 	return 0;
 }
 modinfo_t modinfo_shadow = {
@@ -203,9 +203,10 @@ static void usage(const char *argv0, int ret) {
 	    "\n"
 	    "--blur-method\n"
 	    "  The algorithm used for background bluring. Available choices are:\n"
-	    "  'none' to disable, 'gaussian', 'box' or 'kernel' for custom\n"
-	    "  convolution blur with --blur-kern.\n"
-	    "  Note: 'gaussian' and 'box' require --experimental-backends.\n"
+	    "  'none' to disable, 'gaussian', 'box', 'dual_kawase' or 'kernel'\n"
+	    "  for custom convolution blur with --blur-kern.\n"
+	    "  Note: 'gaussian', 'box' and 'dual_kawase' require\n"
+	    "  --experimental-backends. 'dual_kawase' requires the glx backend.\n"
 	    "\n"
 	    "--blur-size\n"
 	    "  The radius of the blur kernel for 'box' and 'gaussian' blur method.\n"
@@ -213,6 +214,10 @@ static void usage(const char *argv0, int ret) {
 	    "--blur-deviation\n"
 	    "  The standard deviation for the 'gaussian' blur method.\n"
 	    "\n"
+	    "--blur-strength\n"
+	    "  The strength of the 'dual_kawase' blur method, from 1 to 20. If\n"
+	    "  not set, it is derived from --blur-size.\n"
+	    "\n"
 	    "--blur-background\n"
 	    "  Blur background of semi-transparent / ARGB windows. Bad in\n"
 	    "  performance. The switch name may change without prior\n"
@@ -306,6 +311,20 @@ static void usage(const char *argv0, int ret) {
 	    "  Additionally use X Sync fence to sync clients' draw calls. Needed\n"
 	    "  on nvidia-drivers with GLX backend for some users.\n"
 	    "\n"
+	    "--xrender-buffers count\n"
+	    "  Number of back buffers the new xrender backend renders into when\n"
+	    "  vsync is enabled, from 2 to 4. More buffers reduce the chance of\n"
+	    "  waiting for a buffer that is still being scanned out, at the cost\n"
+	    "  of memory. Default: 2.\n"
+	    "\n"
+	    "--damage-max-rects count\n"
+	    "  Maximum number of rectangles the damage a window reports in one\n"
+	    "  frame is merged into. 0 to disable merging. Default: 32.\n"
+	    "\n"
+	    "--damage-max-waste fraction\n"
+	    "  Merge damage rectangles of a window further as long as at most this\n"
+	    "  fraction of the merged rectangle is undamaged. Default: 0.1.\n"
+	    "\n"
 	    "--force-win-blend\n"
 	    "  Force all windows to be painted with blending. Useful if you have a\n"
 	    "  --glx-fshader-win that could turn opaque pixels transparent.\n"
@@ -438,6 +457,10 @@ static const struct option longopts[] = {
     {"blur-method", required_argument, NULL, 328},
     {"blur-size", required_argument, NULL, 329},
     {"blur-deviation", required_argument, NULL, 330},
+    {"xrender-buffers", required_argument, NULL, 331},
+    {"blur-strength", required_argument, NULL, 332},
+    {"damage-max-rects", required_argument, NULL, 333},
+    {"damage-max-waste", required_argument, NULL, 334},
     {"experimental-backends", no_argument, NULL, 733},
     {"monitor-repaint", no_argument, NULL, 800},
     {"diagnostics", no_argument, NULL, 801},
@@ -866,6 +889,16 @@ bool get_cfg(options_t *opt, int argc, char *const *argv, bool shadow_enable,
 			// --blur-deviation
 			module_xsetfloat(ps->module_blur, "deviation", atof(optarg));
 			break;
+		P_CASEINT(331, xrender_buffers);
+		case 332:
+			// --blur-strength
+			module_xsetint(ps->module_blur, "strength", atoi(optarg));
+			break;
+		P_CASEINT(333, damage_max_rects);
+		case 334:
+			// --damage-max-waste
+			opt->damage_max_waste = atof(optarg);
+			break;
 
 		P_CASEBOOL(733, experimental_backends);
 		P_CASEBOOL(800, monitor_repaint);
@@ -915,6 +948,9 @@ bool get_cfg(options_t *opt, int argc, char *const *argv, bool shadow_enable,
 	opt->frame_opacity = normalize_d(opt->frame_opacity);
 	opt->shadow_opacity = normalize_d(opt->shadow_opacity);
 	opt->refresh_rate = normalize_i_range(opt->refresh_rate, 0, 300);
+	opt->xrender_buffers = normalize_i_range(opt->xrender_buffers, 2, 4);
+	opt->damage_max_rects = max2(opt->damage_max_rects, 0);
+	opt->damage_max_waste = normalize_d(opt->damage_max_waste);
 
 	opt->max_brightness = normalize_d(opt->max_brightness);
 	if (opt->max_brightness < 1.0) {
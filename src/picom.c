@@ -48,6 +48,7 @@
 #include "config.h"
 #include "diagnostic.h"
 #include "log.h"
+#include "prop_cache.h"
 #include "region.h"
 #include "compton-compat/render.h"
 #include "types.h"
@@ -119,15 +120,6 @@ static inline void free_xinerama_info(session_t *ps) {
 	ps->xinerama_nscrs = 0;
 }
 
-/**
- * Get current system clock in milliseconds.
- */
-static inline int64_t get_time_ms(void) {
-	struct timespec tp;
-	clock_gettime(CLOCK_MONOTONIC, &tp);
-	return (int64_t)tp.tv_sec * 1000 + (int64_t)tp.tv_nsec / 1000000;
-}
-
 // XXX Move to x.c
 void cxinerama_upd_scrs(session_t *ps) {
 	// XXX Consider deprecating Xinerama, switch to RandR when necessary
@@ -197,7 +189,7 @@ static inline void get_screen_region(session_t *ps, region_t *res) {
 	pixman_region32_init_rects(res, &b, 1);
 }
 
-void add_damage(session_t *ps, const region_t *damage) {
+static void _add_damage(session_t *ps, struct managed_win *w, const region_t *damage) {
 	// Ignore damage when screen isn't redirected
 	if (!ps->redirected)
 		return;
@@ -205,66 +197,15 @@ void add_damage(session_t *ps, const region_t *damage) {
 	if (!damage)
 		return;
 	pixman_region32_union(ps->damage, ps->damage, (region_t *)damage);
+	module_emit(MODEV_DAMAGE, ps, &(struct modev_damage){.w = w, .damage = damage});
 }
 
-// === Fading ===
-
-/**
- * Get the time left before next fading point.
- *
- * In milliseconds.
- */
-static double fade_timeout(session_t *ps) {
-	auto now = get_time_ms();
-	if (ps->o.fade_delta + ps->fade_time < now)
-		return 0;
-
-	auto diff = ps->o.fade_delta + ps->fade_time - now;
-
-	diff = clamp(diff, 0, ps->o.fade_delta * 2);
-
-	return (double)diff / 1000.0;
+void add_damage(session_t *ps, const region_t *damage) {
+	_add_damage(ps, NULL, damage);
 }
 
-/**
- * Run fading on a window.
- *
- * @param steps steps of fading
- * @return whether we are still in fading mode
- */
-static bool run_fade(session_t *ps, struct managed_win **_w, long steps) {
-	auto w = *_w;
-	if (w->state == WSTATE_MAPPED || w->state == WSTATE_UNMAPPED) {
-		// We are not fading
-		assert(w->opacity_target == w->opacity);
-		return false;
-	}
-
-	if (!win_should_fade(ps, w)) {
-		log_debug("Window %#010x %s doesn't need fading", w->base.id, w->name);
-		w->opacity = w->opacity_target;
-	}
-	if (w->opacity == w->opacity_target) {
-		// We have reached target opacity.
-		// We don't call win_check_fade_finished here because that could destroy
-		// the window, but we still need the damage info from this window
-		log_debug("Fading finished for window %#010x %s", w->base.id, w->name);
-		return false;
-	}
-
-	if (steps) {
-		if (w->opacity < w->opacity_target) {
-			w->opacity = clamp(w->opacity + ps->o.fade_in_step * (double)steps,
-			                   0.0, w->opacity_target);
-		} else {
-			w->opacity = clamp(w->opacity - ps->o.fade_out_step * (double)steps,
-			                   w->opacity_target, 1);
-		}
-	}
-
-	// Note even if opacity == opacity_target here, we still want to run preprocess
-	// one last time to finish state transition. So return true in that case too.
-	return true;
+void add_win_content_damage(session_t *ps, struct managed_win *w, const region_t *damage) {
+	_add_damage(ps, w, damage);
 }
 
 // === Error handling ===
@@ -335,6 +276,22 @@ void update_ewmh_active_win(session_t *ps) {
 	}
 }
 
+/**
+ * Mark the window with input focus `wid` as focused.
+ */
+static void set_focused_window(session_t *ps, xcb_window_t wid) {
+	auto w = find_win_all(ps, wid);
+
+	log_trace("%#010" PRIx32 " (%#010lx \"%s\") focused.", wid,
+	          (w ? w->base.id : XCB_NONE), (w ? w->name : NULL));
+
+	// And we set the focus state here
+	if (w) {
+		win_set_focused(ps, w);
+		return;
+	}
+}
+
 /**
  * Recheck currently focused window and set its <code>w->focused</code>
  * to true.
@@ -360,44 +317,65 @@ static void recheck_focus(session_t *ps) {
 		free(reply);
 	}
 
-	auto w = find_win_all(ps, wid);
+	set_focused_window(ps, wid);
+}
 
-	log_trace("%#010" PRIx32 " (%#010lx \"%s\") focused.", wid,
-	          (w ? w->base.id : XCB_NONE), (w ? w->name : NULL));
+/**
+ * Look for a client window among `windows` and their descendants, in the same order
+ * as a depth first search would.
+ *
+ * WM_STATE and the children of all the windows are asked for at once, so the search
+ * costs about a round trip per level of the window tree, not two per window.
+ */
+static xcb_window_t
+find_client_win_in(session_t *ps, const xcb_window_t *windows, int nwindows) {
+	if (!nwindows) {
+		return XCB_NONE;
+	}
+
+	auto pcookies = ccalloc(nwindows, xcb_get_property_cookie_t);
+	auto tcookies = ccalloc(nwindows, xcb_query_tree_cookie_t);
+	for (int i = 0; i < nwindows; i++) {
+		pcookies[i] = xcb_get_property(ps->c, 0, windows[i], ps->atoms->aWM_STATE,
+		                               XCB_GET_PROPERTY_TYPE_ANY, 0, 0);
+		tcookies[i] = xcb_query_tree(ps->c, windows[i]);
+	}
+
+	xcb_window_t ret = XCB_NONE;
+	int i = 0;
+	for (; i < nwindows && !ret; i++) {
+		auto r = xcb_get_property_reply(ps->c, pcookies[i], NULL);
+		bool has_state = r && r->type != XCB_NONE;
+		free(r);
+		if (has_state) {
+			xcb_discard_reply(ps->c, tcookies[i].sequence);
+			ret = windows[i];
+			continue;
+		}
 
-	// And we set the focus state here
-	if (w) {
-		win_set_focused(ps, w);
-		return;
+		auto tree = xcb_query_tree_reply(ps->c, tcookies[i], NULL);
+		if (tree) {
+			ret = find_client_win_in(ps, xcb_query_tree_children(tree),
+			                         xcb_query_tree_children_length(tree));
+			free(tree);
+		}
 	}
+	// Found the client, drop the replies we won't look at
+	for (; i < nwindows; i++) {
+		xcb_discard_reply(ps->c, pcookies[i].sequence);
+		xcb_discard_reply(ps->c, tcookies[i].sequence);
+	}
+
+	free(pcookies);
+	free(tcookies);
+	return ret;
 }
 
 /**
  * Look for the client window of a particular window.
  */
 xcb_window_t find_client_win(session_t *ps, xcb_window_t w) {
-	if (wid_has_prop(ps, w, ps->atoms->aWM_STATE)) {
-		return w;
-	}
-
-	xcb_query_tree_reply_t *reply =
-	    xcb_query_tree_reply(ps->c, xcb_query_tree(ps->c, w), NULL);
-	if (!reply)
-		return 0;
-
-	xcb_window_t *children = xcb_query_tree_children(reply);
-	int nchildren = xcb_query_tree_children_length(reply);
-	int i;
-	xcb_window_t ret = 0;
-
-	for (i = 0; i < nchildren; ++i) {
-		if ((ret = find_client_win(ps, children[i])))
-			break;
-	}
-
-	free(reply);
-
-	return ret;
+	return find_client_win_in(ps, &w, 1);
 }
 
 static void handle_root_flags(session_t *ps) {
@@ -417,49 +395,111 @@ static void handle_root_flags(session_t *ps) {
 	}
 }
 
+/// Subtract and fetch the damage of the windows repair_win deferred.
+///
+/// All requests are sent before waiting for any reply, so this costs one round trip
+/// however many windows were damaged.
+static void fetch_pending_damage(session_t *ps) {
+	int count = 0;
+	win_stack_foreach_managed(w, &ps->window_stack) {
+		if (w->damage_fetch_pending) {
+			count++;
+		}
+	}
+	if (!count) {
+		return;
+	}
+
+	auto cookies = ccalloc(count, xcb_xfixes_fetch_region_cookie_t);
+	int i = 0;
+	win_stack_foreach_managed(w, &ps->window_stack) {
+		if (!w->damage_fetch_pending) {
+			continue;
+		}
+		if (!ps->redirected) {
+			// Why care about damage when screen is unredirected?
+			// We will force full-screen repaint on redirection.
+			set_ignore_cookie(
+			    ps, xcb_damage_subtract(ps->c, w->damage, XCB_NONE, XCB_NONE));
+			w->damage_fetch_pending = false;
+			continue;
+		}
+
+		xcb_xfixes_region_t tmp = x_new_id(ps->c);
+		xcb_xfixes_create_region(ps->c, tmp, 0, NULL);
+		set_ignore_cookie(ps, xcb_damage_subtract(ps->c, w->damage, XCB_NONE, tmp));
+		cookies[i++] = xcb_xfixes_fetch_region(ps->c, tmp);
+		xcb_xfixes_destroy_region(ps->c, tmp);
+	}
+
+	i = 0;
+	win_stack_foreach_managed(w, &ps->window_stack) {
+		if (!w->damage_fetch_pending) {
+			continue;
+		}
+		w->damage_fetch_pending = false;
+
+		auto r = xcb_xfixes_fetch_region_reply(ps->c, cookies[i++], NULL);
+		if (!r) {
+			log_error("Failed to fetch the damage of window %#010x", w->base.id);
+			continue;
+		}
+		region_t parts;
+		x_region_from_fetch_reply(r, &parts);
+		free(r);
+		pixman_region32_translate(&parts, w->g.x + w->g.border_width,
+		                          w->g.y + w->g.border_width);
+		pixman_region32_union(&w->pending_damage, &w->pending_damage, &parts);
+		pixman_region32_fini(&parts);
+	}
+	free(cookies);
+}
+
+/// Add the content damage windows reported since the last frame to the screen damage.
+///
+/// Bursty clients can report hundreds of small damaged rectangles in one frame. They are
+/// merged here into a few boxes, so the backends don't have to paint them one by one.
+static void flush_pending_damage(session_t *ps) {
+	fetch_pending_damage(ps);
+	win_stack_foreach_managed(w, &ps->window_stack) {
+		if (!pixman_region32_not_empty(&w->pending_damage)) {
+			continue;
+		}
+		if (ps->o.damage_max_rects > 0) {
+			region_coalesce(&w->pending_damage, ps->o.damage_max_rects,
+			                ps->o.damage_max_waste);
+		}
+
+		// Remove the part in the damage area that could be ignored
+		if (w->reg_ignore && win_is_region_ignore_valid(ps, w)) {
+			pixman_region32_subtract(&w->pending_damage, &w->pending_damage,
+			                         w->reg_ignore);
+		}
+
+		add_win_content_damage(ps, w, &w->pending_damage);
+		pixman_region32_clear(&w->pending_damage);
+	}
+}
+
 static struct managed_win *paint_preprocess(session_t *ps, bool *fade_running) {
 	// XXX need better, more general name for `fade_running`. It really
 	// means if fade is still ongoing after the current frame is rendered
 	struct managed_win *bottom = NULL;
-	*fade_running = false;
-
-	// Fading step calculation
-	long steps = 0L;
-	auto now = get_time_ms();
-	if (ps->fade_time) {
-		assert(now >= ps->fade_time);
-		steps = (now - ps->fade_time) / ps->o.fade_delta;
-	} else {
-		// Reset fade_time if unset
-		ps->fade_time = get_time_ms();
-		steps = 0L;
-	}
-	ps->fade_time += steps * ps->o.fade_delta;
 
-	// First, let's process fading
+	// First, let modules update the windows, the fade module runs fading here
+	struct modev_paint_start ev = {.animating = false};
+	module_emit(MODEV_STAGE_PAINT_START, ps, &ev);
+	*fade_running = ev.animating;
+
 	win_stack_foreach_managed_safe(w, &ps->window_stack) {
 		const winmode_t mode_old = w->mode;
 		const bool was_painted = w->to_paint;
-		const double opacity_old = w->opacity;
 
 		if (win_should_dim(ps, w) != w->dim) {
 			w->dim = win_should_dim(ps, w);
 			add_damage_from_win(ps, w);
 		}
 
-		// Run fading
-		if (run_fade(ps, &w, steps)) {
-			*fade_running = true;
-		}
-
-		// Add window to damaged area if its opacity changes
-		// If was_painted == false, and to_paint is also false, we don't care
-		// If was_painted == false, but to_paint is true, damage will be added in
-		// the loop below
-		if (was_painted && w->opacity != opacity_old) {
-			add_damage_from_win(ps, w);
-		}
-
 		if (win_check_fade_finished(ps, w)) {
 			// the window has been destroyed because fading finished
 			continue;
@@ -671,6 +711,11 @@ static void rebuild_shadow_exclude_reg(session_t *ps) {
 
 /// Free up all the images and deinit the backend
 static void destroy_backend(session_t *ps) {
+	if (ps->backend_data && ps->backend_data->busy && ps->redraw_needed) {
+		// A frame might have been delayed waiting for this backend, which
+		// will now never become ready.
+		ev_idle_start(ps->loop, &ps->draw_idle);
+	}
 	module_emit(MODEV_BACKEND_DESTROY_START, ps, NULL);
 	module_emit(MODEV_BACKEND_DESTROY_DONE, ps, NULL);
 }
@@ -1180,6 +1225,22 @@ static void unredirect(session_t *ps) {
 	log_debug("Screen unredirected.");
 }
 
+/// Let the backend handle its events, and restart drawing if the backend became ready
+/// while we have a redraw pending.
+static void handle_backend_events(session_t *ps) {
+	if (!ps->backend_data || !ps->backend_data->ops->handle_events) {
+		return;
+	}
+
+	bool was_busy = ps->backend_data->busy;
+	ps->backend_data->ops->handle_events(ps->backend_data);
+	if (was_busy && !ps->backend_data->busy && ps->redraw_needed) {
+		// _draw_callback bailed out because the backend was busy, and left
+		// redraw_needed set, so queue_redraw wouldn't restart the idle watcher.
+		ev_idle_start(ps->loop, &ps->draw_idle);
+	}
+}
+
 // Handle queued events before we go to sleep
 static void handle_queued_x_events(EV_P attr_unused, ev_prepare *w, int revents attr_unused) {
 	session_t *ps = session_ptr(w, event_check);
@@ -1188,6 +1249,7 @@ static void handle_queued_x_events(EV_P attr_unused, ev_prepare *w, int revents
 		ev_handle(ps, ev);
 		free(ev);
 	};
+	handle_backend_events(ps);
 	// Flush because if we go into sleep when there is still
 	// requests in the outgoing buffer, they will not be sent
 	// for an indefinite amount of time.
@@ -1203,18 +1265,51 @@ static void handle_queued_x_events(EV_P attr_unused, ev_prepare *w, int revents
 }
 
 static void handle_new_windows(session_t *ps) {
-	list_foreach_safe(struct win, w, &ps->window_stack, stack_neighbour) {
+	// Query all the new windows before waiting for any reply, so adding them costs
+	// one round trip, not one per window. Their properties are prefetched as well,
+	// a window is its own client unless the window manager reparented it.
+	int count = 0;
+	list_foreach(struct win, w, &ps->window_stack, stack_neighbour) {
 		if (w->is_new) {
-			auto new_w = fill_win(ps, w);
-			if (!new_w->managed) {
-				continue;
-			}
+			count++;
+		}
+	}
+	if (!count) {
+		return;
+	}
+
+	auto acookies = ccalloc(count, xcb_get_window_attributes_cookie_t);
+	auto gcookies = ccalloc(count, xcb_get_geometry_cookie_t);
+	int i = 0;
+	list_foreach(struct win, w, &ps->window_stack, stack_neighbour) {
+		if (w->is_new) {
+			acookies[i] = xcb_get_window_attributes(ps->c, w->id);
+			gcookies[i] = xcb_get_geometry(ps->c, w->id);
+			prop_cache_prefetch(ps, w->id, ps->atoms->aWM_STATE);
+			win_prefetch_props(ps, w->id);
+			i++;
+		}
+	}
+
+	i = 0;
+	list_foreach_safe(struct win, w, &ps->window_stack, stack_neighbour) {
+		if (!w->is_new) {
+			continue;
+		}
+		auto a = xcb_get_window_attributes_reply(ps->c, acookies[i], NULL);
+		auto g = xcb_get_geometry_reply(ps->c, gcookies[i], NULL);
+		i++;
+
+		xcb_window_t id = w->id;
+		bool mapped = false;
+		auto new_w = fill_win(ps, w, a);
+		if (new_w->managed) {
 			auto mw = (struct managed_win *)new_w;
 			if (mw->a.map_state == XCB_MAP_STATE_VIEWABLE) {
 				// Have to map immediately instead of queue window update
 				// because we need the window's extent right now.
 				// We can do this because we are in the critical section.
-				map_win_start(ps, mw);
+				map_win_start_with_geometry(ps, mw, g);
 
 				// This window might be damaged before we called fill_win
 				// and created the damage handle. And there is no way for
@@ -1222,8 +1317,18 @@ static void handle_new_windows(session_t *ps) {
 				mw->ever_damaged = true;
 				add_damage_from_win(ps, mw);
 			}
+			mapped = mw->state == WSTATE_MAPPING ||
+			         mw->state == WSTATE_FADING || mw->state == WSTATE_MAPPED;
+		}
+		if (!mapped) {
+			// We don't listen to property changes of this window, so what we
+			// prefetched can't be kept
+			prop_cache_invalidate_window(ps->prop_cache, id);
 		}
+		free(g);
 	}
+	free(acookies);
+	free(gcookies);
 }
 
 static void refresh_windows(session_t *ps) {
@@ -1264,6 +1369,11 @@ static void handle_pending_updates(EV_P_ struct session *ps) {
 		}
 
 		ps->server_grabbed = true;
+		auto grab_start = get_time_timespec();
+
+		// Nothing can change the focus while the server is grabbed, so ask for it
+		// now, the reply arrives while we process the updates.
+		auto focus_cookie = xcb_get_input_focus(ps->c);
 
 		// Catching up with X server
 		handle_queued_x_events(EV_A_ & ps->event_check, 0);
@@ -1275,10 +1385,13 @@ static void handle_pending_updates(EV_P_ struct session *ps) {
 		refresh_windows(ps);
 
 		{
-			auto r = xcb_get_input_focus_reply(
-			    ps->c, xcb_get_input_focus(ps->c), NULL);
+			auto r = xcb_get_input_focus_reply(ps->c, focus_cookie, NULL);
 			if (!ps->active_win || (r && r->focus != ps->active_win->base.id)) {
-				recheck_focus(ps);
+				if (r && !ps->o.use_ewmh_active_win) {
+					set_focused_window(ps, r->focus);
+				} else {
+					recheck_focus(ps);
+				}
 			}
 			free(r);
 		}
@@ -1286,9 +1399,6 @@ static void handle_pending_updates(EV_P_ struct session *ps) {
 		// Refresh pixmaps and shadows
 		refresh_stale_images(ps);
 
-		// Handle screen changes
-		handle_root_flags(ps);
-
 		e = xcb_request_check(ps->c, xcb_ungrab_server_checked(ps->c));
 		if (e) {
 			log_fatal("failed to ungrab x server");
@@ -1297,15 +1407,36 @@ static void handle_pending_updates(EV_P_ struct session *ps) {
 			return quit(ps);
 		}
 
+		auto grab_end = get_time_timespec();
+		struct timespec held;
+		timespec_subtract(&held, &grab_end, &grab_start);
+		auto grab_time = (uint64_t)held.tv_sec * 1000000 + (uint64_t)held.tv_nsec / 1000;
+		ps->grab_count++;
+		ps->grab_time_total += grab_time;
+		ps->grab_time_max = max2(ps->grab_time_max, grab_time);
+
 		ps->server_grabbed = false;
 		ps->pending_updates = false;
-		log_debug("Exited critical section");
+		log_debug("Exited critical section, held the X server for %" PRIu64 " us",
+		          grab_time);
+
+		// Handle screen changes. This doesn't depend on the window stack, so it
+		// doesn't need the server grabbed.
+		handle_root_flags(ps);
 	}
 }
 
 static void _draw_callback(EV_P_ session_t *ps, int revents attr_unused) {
 	handle_pending_updates(EV_A_ ps);
 
+	if (ps->backend_data && ps->backend_data->busy) {
+		// The backend is still waiting for the previous frame to complete. Leave
+		// redraw_needed set, handle_backend_events will restart drawing once the
+		// backend is ready.
+		log_trace("Backend is busy, delaying the frame");
+		return;
+	}
+
 	if (ps->first_frame) {
 		// If we are still rendering the first frame, if some of the windows are
 		// unmapped/destroyed during the above handle_pending_updates() call, they
@@ -1320,6 +1451,8 @@ static void _draw_callback(EV_P_ session_t *ps, int revents attr_unused) {
 		}
 	}
 
+	flush_pending_damage(ps);
+
 	if (ps->o.benchmark) {
 		if (ps->o.benchmark_wid) {
 			auto w = find_managed_win(ps, ps->o.benchmark_wid);
@@ -1353,11 +1486,16 @@ static void _draw_callback(EV_P_ session_t *ps, int revents attr_unused) {
 		return _draw_callback(EV_A_ ps, revents);
 	}
 
-	// Start/stop fade timer depends on whether window are fading
+	// Start/stop fade timer depends on whether window are fading. Fading is
+	// interpolated from the frame time, so if the backend paces frames the next
+	// frame is simply drawn at the next vblank, the backend holds it back until
+	// then. Otherwise don't draw more often than every fade_delta.
 	if (!fade_running && ev_is_active(&ps->fade_timer)) {
 		ev_timer_stop(EV_A_ & ps->fade_timer);
 	} else if (fade_running && !ev_is_active(&ps->fade_timer)) {
-		ev_timer_set(&ps->fade_timer, fade_timeout(ps), 0);
+		bool paced = ps->backend_data && ps->backend_data->paced;
+		ev_timer_set(&ps->fade_timer,
+		             paced ? 0 : (double)ps->o.fade_delta / 1000.0, 0);
 		ev_timer_start(EV_A_ & ps->fade_timer);
 	}
 
@@ -1379,9 +1517,6 @@ static void _draw_callback(EV_P_ session_t *ps, int revents attr_unused) {
 			exit(0);
 	}
 
-	if (!fade_running)
-		ps->fade_time = 0L;
-
 	// TODO xcb_ungrab_server
 
 	ps->redraw_needed = false;
@@ -1504,7 +1639,6 @@ static session_t *session_init(int argc, char **argv, Display *dpy,
 #endif
 	    .redirected = false,
 	    .alpha_picts = NULL,
-	    .fade_time = 0L,
 	    .ignore_head = NULL,
 	    .ignore_tail = NULL,
 	    .quit = false,
@@ -1516,6 +1650,7 @@ static session_t *session_init(int argc, char **argv, Display *dpy,
 	    .windows = NULL,
 	    .active_win = NULL,
 	    .active_leader = XCB_NONE,
+	    .fade_time = 0,
 
 	    .black_picture = XCB_NONE,
 	    .cshadow_picture = XCB_NONE,
@@ -1741,6 +1876,7 @@ static session_t *session_init(int argc, char **argv, Display *dpy,
 	}
 
 	ps->atoms = init_atoms(ps->c);
+	ps->prop_cache = prop_cache_new(ps->c);
 	ps->atoms_wintypes[WINTYPE_UNKNOWN] = 0;
 #define SET_WM_TYPE_ATOM(x)                                                              \
 	ps->atoms_wintypes[WINTYPE_##x] = ps->atoms->a_NET_WM_WINDOW_TYPE_##x
@@ -2078,6 +2214,22 @@ static void session_destroy(session_t *ps) {
 
 	module_emit(MODEV_EARLY_EXIT, ps, NULL);
 
+	if (ps->grab_count) {
+		log_info("Grabbed the X server %" PRIu64 " times, for %" PRIu64
+		         " us on average, %" PRIu64 " us at most",
+		         ps->grab_count, ps->grab_time_total / ps->grab_count,
+		         ps->grab_time_max);
+	}
+	{
+		uint64_t hits, misses;
+		prop_cache_get_stats(ps->prop_cache, &hits, &misses);
+		if (hits + misses) {
+			log_info("Property cache: %" PRIu64 " hits, %" PRIu64
+			         " misses, %.1f%% hit rate",
+			         hits, misses, 100.0 * (double)hits / (double)(hits + misses));
+		}
+	}
+
 	// Free window linked list
 
 	list_foreach_safe(struct win, w, &ps->window_stack, stack_neighbour) {
@@ -2206,6 +2358,7 @@ static void session_destroy(session_t *ps) {
 	ev_io_stop(ps->loop, &ps->xiow);
 	free_conv(ps->gaussian_map);
 	destroy_atoms(ps->atoms);
+	prop_cache_free(ps->prop_cache);
 
 #ifdef DEBUG_XRC
 	// Report about resource leakage
@@ -38,6 +38,8 @@ enum root_flags { ROOT_FLAGS_SCREEN_CHANGE = 1 };
 // http://clang.llvm.org/compatibility.html#inline
 
 void add_damage(session_t *ps, const region_t *damage);
+/// Add damage caused by a change of the content of `w`
+void add_win_content_damage(session_t *ps, struct managed_win *w, const region_t *damage);
 
 uint32_t determine_evmask(session_t *ps, xcb_window_t wid, win_evmode_t mode);
 
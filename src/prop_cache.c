@@ -0,0 +1,252 @@
+// SPDX-License-Identifier: MPL-2.0
+#include <X11/Xutil.h>
+#include <uthash.h>
+#include <xcb/xcb.h>
+
+#include "utils/utils.h"
+
+#include "common.h"
+#include "prop_cache.h"
+#include "x.h"
+
+/// Maximum length of a cached property, in 32-bit units. Longer properties are always
+/// fetched from the X server.
+#define PROP_CACHE_MAX_LENGTH 0x4000
+
+struct prop_cache_entry {
+	xcb_atom_t atom;
+	/// The whole property, fetched with type AnyPropertyType. NULL if the request
+	/// failed.
+	xcb_get_property_reply_t *r;
+	/// Whether the property was prefetched and `cookie` hasn't been replied to yet
+	bool pending;
+	xcb_get_property_cookie_t cookie;
+	UT_hash_handle hh;
+};
+
+struct prop_cache_window {
+	xcb_window_t id;
+	struct prop_cache_entry *props;
+	UT_hash_handle hh;
+};
+
+struct prop_cache {
+	xcb_connection_t *c;
+	struct prop_cache_window *windows;
+	uint64_t hits, misses;
+};
+
+struct prop_cache *prop_cache_new(xcb_connection_t *c) {
+	auto cache = ccalloc(1, struct prop_cache);
+	cache->c = c;
+	return cache;
+}
+
+static void prop_cache_free_entry(struct prop_cache *c, struct prop_cache_window *pw,
+                                  struct prop_cache_entry *e) {
+	HASH_DEL(pw->props, e);
+	if (e->pending) {
+		xcb_discard_reply(c->c, e->cookie.sequence);
+	}
+	free(e->r);
+	free(e);
+}
+
+static void prop_cache_free_window(struct prop_cache *c, struct prop_cache_window *pw) {
+	struct prop_cache_entry *e, *tmpe;
+	HASH_ITER(hh, pw->props, e, tmpe) {
+		prop_cache_free_entry(c, pw, e);
+	}
+	HASH_DEL(c->windows, pw);
+	free(pw);
+}
+
+static inline xcb_get_property_cookie_t
+prop_cache_request(session_t *ps, xcb_window_t w, xcb_atom_t atom) {
+	return xcb_get_property(ps->c, 0, w, atom, XCB_GET_PROPERTY_TYPE_ANY, 0,
+	                        PROP_CACHE_MAX_LENGTH);
+}
+
+/// Find the cached properties of a window, adding an empty entry for it if `add` is
+/// true
+static struct prop_cache_window *
+prop_cache_find_window(struct prop_cache *c, xcb_window_t w, bool add) {
+	struct prop_cache_window *pw = NULL;
+	HASH_FIND_INT(c->windows, &w, pw);
+	if (!pw && add) {
+		pw = ccalloc(1, struct prop_cache_window);
+		pw->id = w;
+		HASH_ADD_INT(c->windows, id, pw);
+	}
+	return pw;
+}
+
+void prop_cache_free(struct prop_cache *c) {
+	struct prop_cache_window *pw, *tmpw;
+	HASH_ITER(hh, c->windows, pw, tmpw) {
+		prop_cache_free_window(c, pw);
+	}
+	free(c);
+}
+
+/// Find a property in the cache, fetching it from the X server if it's not there.
+///
+/// @return the cache entry, NULL if the property is too long to be cached
+static struct prop_cache_entry *
+prop_cache_lookup(session_t *ps, xcb_window_t w, xcb_atom_t atom) {
+	auto c = ps->prop_cache;
+	struct prop_cache_entry *e = NULL;
+	auto pw = prop_cache_find_window(c, w, false);
+	if (pw) {
+		HASH_FIND_INT(pw->props, &atom, e);
+	}
+	if (e && !e->pending) {
+		c->hits++;
+		return e;
+	}
+
+	c->misses++;
+	auto cookie = e ? e->cookie : prop_cache_request(ps, w, atom);
+	auto r = xcb_get_property_reply(ps->c, cookie, NULL);
+	if (e) {
+		e->pending = false;
+	}
+	if (r && r->bytes_after) {
+		if (e) {
+			prop_cache_free_entry(c, pw, e);
+		}
+		free(r);
+		return NULL;
+	}
+
+	if (!e) {
+		pw = prop_cache_find_window(c, w, true);
+		e = ccalloc(1, struct prop_cache_entry);
+		e->atom = atom;
+		HASH_ADD_INT(pw->props, atom, e);
+	}
+	e->r = r;
+	return e;
+}
+
+void prop_cache_prefetch(session_t *ps, xcb_window_t w, xcb_atom_t atom) {
+	auto pw = prop_cache_find_window(ps->prop_cache, w, true);
+	struct prop_cache_entry *e = NULL;
+	HASH_FIND_INT(pw->props, &atom, e);
+	if (e) {
+		return;
+	}
+
+	e = ccalloc(1, struct prop_cache_entry);
+	e->atom = atom;
+	e->pending = true;
+	e->cookie = prop_cache_request(ps, w, atom);
+	HASH_ADD_INT(pw->props, atom, e);
+}
+
+static inline bool prop_has_value(const xcb_get_property_reply_t *r) {
+	return r && (r->format == 8 || r->format == 16 || r->format == 32) &&
+	       xcb_get_property_value_length(r);
+}
+
+winprop_t prop_cache_get(session_t *ps, xcb_window_t w, xcb_atom_t atom, int offset,
+                         int length, xcb_atom_t rtype, int rformat) {
+	auto e = prop_cache_lookup(ps, w, atom);
+	if (!e) {
+		return x_get_prop_with_offset(ps, w, atom, offset, length, rtype, rformat);
+	}
+
+	const winprop_t blank = {
+	    .ptr = NULL, .nitems = 0, .type = XCB_GET_PROPERTY_TYPE_ANY, .format = 0};
+	auto r = e->r;
+	if (!prop_has_value(r) || (rtype != XCB_GET_PROPERTY_TYPE_ANY && r->type != rtype) ||
+	    (rformat && r->format != rformat)) {
+		return blank;
+	}
+
+	// Offset and length are in 32-bit units, like in GetProperty requests
+	int64_t len = xcb_get_property_value_length(r);
+	int64_t start = min2((int64_t)offset * 4, len);
+	int64_t end = min2(start + (int64_t)length * 4, len);
+	if (offset < 0 || end <= start) {
+		return blank;
+	}
+	return (winprop_t){
+	    .ptr = (char *)xcb_get_property_value(r) + start,
+	    .nitems = (ulong)((end - start) / (r->format / 8)),
+	    .type = r->type,
+	    .format = r->format,
+	    .r = NULL,
+	};
+}
+
+bool prop_cache_get_text(session_t *ps, xcb_window_t w, xcb_atom_t atom, char ***pstrlst,
+                         int *pnstr) {
+	auto e = prop_cache_lookup(ps, w, atom);
+	if (!e) {
+		return wid_get_text_prop(ps, w, atom, pstrlst, pnstr);
+	}
+
+	auto r = e->r;
+	if (!prop_has_value(r)) {
+		return false;
+	}
+
+	// Xlib NUL terminates the values it returns, and XmbTextPropertyToTextList
+	// relies on it.
+	auto len = (size_t)xcb_get_property_value_length(r);
+	char *value = malloc(len + 1);
+	allocchk(value);
+	memcpy(value, xcb_get_property_value(r), len);
+	value[len] = '\0';
+
+	XTextProperty text_prop = {
+	    .value = (unsigned char *)value,
+	    .encoding = r->type,
+	    .format = r->format,
+	    .nitems = len / (size_t)(r->format / 8),
+	};
+	bool ret = true;
+	if (Success != XmbTextPropertyToTextList(ps->dpy, &text_prop, pstrlst, pnstr) ||
+	    !*pnstr) {
+		*pnstr = 0;
+		if (*pstrlst) {
+			XFreeStringList(*pstrlst);
+			*pstrlst = NULL;
+		}
+		ret = false;
+	}
+	free(value);
+	return ret;
+}
+
+bool prop_cache_has(session_t *ps, xcb_window_t w, xcb_atom_t atom) {
+	auto e = prop_cache_lookup(ps, w, atom);
+	if (!e) {
+		return wid_has_prop(ps, w, atom);
+	}
+	return e->r && e->r->type != XCB_NONE;
+}
+
+void prop_cache_invalidate(struct prop_cache *c, xcb_window_t w, xcb_atom_t atom) {
+	struct prop_cache_entry *e = NULL;
+	auto pw = prop_cache_find_window(c, w, false);
+	if (pw) {
+		HASH_FIND_INT(pw->props, &atom, e);
+	}
+	if (e) {
+		prop_cache_free_entry(c, pw, e);
+	}
+}
+
+void prop_cache_invalidate_window(struct prop_cache *c, xcb_window_t w) {
+	auto pw = prop_cache_find_window(c, w, false);
+	if (pw) {
+		prop_cache_free_window(c, pw);
+	}
+}
+
+void prop_cache_get_stats(const struct prop_cache *c, uint64_t *hits, uint64_t *misses) {
+	*hits = c->hits;
+	*misses = c->misses;
+}
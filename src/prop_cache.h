@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: MPL-2.0
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <xcb/xcb.h>
+
+#include "x.h"
+
+typedef struct session session_t;
+
+/// A cache of window properties, keyed by window and atom.
+///
+/// Entries are only valid as long as we receive PropertyNotify events for their window,
+/// and have to be invalidated when a property changes, or when we stop listening for
+/// property changes on the window.
+struct prop_cache;
+
+struct prop_cache *prop_cache_new(xcb_connection_t *c);
+void prop_cache_free(struct prop_cache *);
+
+/// Same as x_get_prop_with_offset, but only asks the X server if the property isn't
+/// cached yet.
+///
+/// The returned property points into the cache, it stays valid until the property is
+/// invalidated. free_winprop can be called on it, but doesn't free anything.
+winprop_t prop_cache_get(session_t *ps, xcb_window_t w, xcb_atom_t atom, int offset,
+                         int length, xcb_atom_t rtype, int rformat);
+
+/// Same as wid_get_text_prop, but only asks the X server if the property isn't cached
+/// yet.
+bool prop_cache_get_text(session_t *ps, xcb_window_t w, xcb_atom_t atom, char ***pstrlst,
+                         int *pnstr);
+
+/// Same as wid_has_prop, but only asks the X server if the property isn't cached yet.
+bool prop_cache_has(session_t *ps, xcb_window_t w, xcb_atom_t atom);
+
+/// Ask the X server for a property without waiting for the reply, unless it's cached
+/// already. The reply is only read when the property is looked up, so several
+/// properties can be fetched in a single round trip.
+void prop_cache_prefetch(session_t *ps, xcb_window_t w, xcb_atom_t atom);
+
+/// Invalidate one property of a window.
+void prop_cache_invalidate(struct prop_cache *, xcb_window_t w, xcb_atom_t atom);
+/// Invalidate all the cached properties of a window.
+void prop_cache_invalidate_window(struct prop_cache *, xcb_window_t w);
+
+/// Get the number of lookups served from the cache, and of those that had to ask the X
+/// server.
+void prop_cache_get_stats(const struct prop_cache *, uint64_t *hits, uint64_t *misses);
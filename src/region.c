@@ -0,0 +1,148 @@
+// SPDX-License-Identifier: MPL-2.0
+#include <pixman.h>
+#include <string.h>
+
+#include "region.h"
+#include "utils/utils.h"
+
+static inline int64_t rect_area(const rect_t *r) {
+	return (int64_t)(r->x2 - r->x1) * (r->y2 - r->y1);
+}
+
+/// Bounding box of two rectangles
+static inline rect_t rect_bound(const rect_t *a, const rect_t *b) {
+	return (rect_t){
+	    .x1 = min2(a->x1, b->x1),
+	    .y1 = min2(a->y1, b->y1),
+	    .x2 = max2(a->x2, b->x2),
+	    .y2 = max2(a->y2, b->y2),
+	};
+}
+
+/// Merge `n` disjoint boxes in place, see region_coalesce.
+///
+/// @return the number of boxes left
+static int coalesce_boxes(rect_t *boxes, int n, int max_rects, double max_waste) {
+	// Merge each box into the previous one while little of the result is wasted.
+	// `covered` is the area of the boxes merged into the last one.
+	int m = 0;
+	int64_t covered = 0;
+	for (int i = 0; i < n; i++) {
+		int64_t area = rect_area(&boxes[i]);
+		if (m > 0 && max_waste > 0) {
+			rect_t bound = rect_bound(&boxes[m - 1], &boxes[i]);
+			double waste =
+			    1 - (double)(covered + area) / (double)rect_area(&bound);
+			if (waste <= max_waste) {
+				boxes[m - 1] = bound;
+				covered += area;
+				continue;
+			}
+		}
+		boxes[m++] = boxes[i];
+		covered = area;
+	}
+
+	// Still too many, merge neighbours pairwise. Each round merges up to half of
+	// the boxes, and stops as soon as there are few enough.
+	max_rects = max2(max_rects, 1);
+	while (m > max_rects) {
+		int out = 0;
+		for (int i = 0; i < m; out++) {
+			if (i + 1 < m && out + (m - i) > max_rects) {
+				boxes[out] = rect_bound(&boxes[i], &boxes[i + 1]);
+				i += 2;
+			} else {
+				boxes[out] = boxes[i++];
+			}
+		}
+		m = out;
+	}
+	return m;
+}
+
+void region_coalesce(region_t *region, int max_rects, double max_waste) {
+	int nrects;
+	const rect_t *rects = pixman_region32_rectangles(region, &nrects);
+	if (nrects <= 1 || (nrects <= max_rects && max_waste <= 0)) {
+		return;
+	}
+
+	auto boxes = ccalloc(nrects, rect_t);
+	memcpy(boxes, rects, sizeof(rect_t) * (size_t)nrects);
+	int n = coalesce_boxes(boxes, nrects, max_rects, max_waste);
+	if (n < nrects) {
+		pixman_region32_fini(region);
+		pixman_region32_init_rects(region, boxes, n);
+	}
+	free(boxes);
+}
+
+TEST_CASE(coalesce_boxes_max_waste) {
+	// 200 pixels wide, 10 of them not covered: 5% wasted
+	rect_t boxes[] = {{0, 0, 100, 10}, {100, 0, 200, 9}};
+	TEST_EQUAL(coalesce_boxes(boxes, 2, 32, 0.1), 1);
+	TEST_EQUAL(boxes[0].x1, 0);
+	TEST_EQUAL(boxes[0].y1, 0);
+	TEST_EQUAL(boxes[0].x2, 200);
+	TEST_EQUAL(boxes[0].y2, 10);
+
+	rect_t boxes2[] = {{0, 0, 100, 10}, {100, 0, 200, 9}};
+	TEST_EQUAL(coalesce_boxes(boxes2, 2, 32, 0.01), 2);
+	TEST_EQUAL(boxes2[1].x1, 100);
+	TEST_EQUAL(boxes2[1].y2, 9);
+
+	// Without a waste threshold, boxes are only merged past max_rects
+	TEST_EQUAL(coalesce_boxes(boxes2, 2, 32, 0), 2);
+}
+
+TEST_CASE(coalesce_boxes_max_rects) {
+	// Far apart from each other, merging any of them wastes most of the box
+	rect_t boxes[100];
+	for (int i = 0; i < 100; i++) {
+		boxes[i] = (rect_t){i * 10, i * 10, i * 10 + 5, i * 10 + 5};
+	}
+	int n = coalesce_boxes(boxes, 100, 8, 0.1);
+	TEST_EQUAL(n, 8);
+	// Merged in order, so the boxes still cover everything, in the same order
+	TEST_EQUAL(boxes[0].x1, 0);
+	TEST_EQUAL(boxes[n - 1].x2, 995);
+	for (int i = 1; i < n; i++) {
+		TEST_TRUE(boxes[i].x1 > boxes[i - 1].x2);
+	}
+
+	for (int i = 0; i < 100; i++) {
+		boxes[i] = (rect_t){i * 10, i * 10, i * 10 + 5, i * 10 + 5};
+	}
+	TEST_EQUAL(coalesce_boxes(boxes, 100, 1, 0), 1);
+	TEST_EQUAL(boxes[0].x1, 0);
+	TEST_EQUAL(boxes[0].y2, 995);
+}
+
+TEST_CASE(region_coalesce) {
+	rect_t rects[100];
+	for (int i = 0; i < 100; i++) {
+		rects[i] = (rect_t){i * 10, i * 10, i * 10 + 5, i * 10 + 5};
+	}
+	region_t region;
+
+	// Few enough rectangles, and no waste threshold: left alone
+	pixman_region32_init_rects(&region, rects, 3);
+	region_coalesce(&region, 32, 0);
+	TEST_EQUAL(pixman_region32_n_rects(&region), 3);
+	pixman_region32_fini(&region);
+
+	pixman_region32_init_rects(&region, rects, 100);
+	region_coalesce(&region, 8, 0.1);
+	TEST_EQUAL(pixman_region32_n_rects(&region), 8);
+	auto extents = pixman_region32_extents(&region);
+	TEST_EQUAL(extents->x1, 0);
+	TEST_EQUAL(extents->y1, 0);
+	TEST_EQUAL(extents->x2, 995);
+	TEST_EQUAL(extents->y2, 995);
+	for (int i = 0; i < 100; i++) {
+		TEST_TRUE(pixman_region32_contains_point(&region, rects[i].x1,
+		                                         rects[i].y1, NULL));
+	}
+	pixman_region32_fini(&region);
+}
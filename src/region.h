@@ -98,3 +98,15 @@ static inline region_t resize_region(const region_t *region, int dx, int dy) {
 static inline void resize_region_in_place(region_t *region, int dx, int dy) {
 	return _resize_region(region, region, dx, dy);
 }
+
+/**
+ * Merge the rectangles of a region into their bounding boxes. Neighbouring rectangles
+ * are merged as long as at most `max_waste` of the merged box is not covered by them,
+ * then if there are more than `max_rects` boxes left, they are merged pairwise until
+ * there are at most `max_rects`.
+ *
+ * Only rectangles next to each other in the region are merged. pixman sorts them by
+ * bands, so they are close to each other. This keeps the cost O(n log n) in the
+ * number of rectangles.
+ */
+void region_coalesce(region_t *region, int max_rects, double max_waste);
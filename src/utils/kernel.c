@@ -3,6 +3,9 @@
 
 #include "picom_assert.h"
 #include <math.h>
+#include <string.h>
+
+#include <test.h>
 
 #include "utils/compiler.h"
 #include "utils/kernel.h"
@@ -133,6 +136,86 @@ conv *gaussian_kernel_autodetect_deviation(int shadow_radius) {
 	return gaussian_kernel(std, size);
 }
 
+bool split_separable_kernel(const conv *kernel, conv **row, conv **col) {
+	const int w = kernel->w, h = kernel->h;
+	if (w == 1 || h == 1) {
+		// Already one dimensional
+		return false;
+	}
+
+	// Factor the kernel around its largest element, which keeps the error small
+	int pivot = 0;
+	for (int i = 1; i < w * h; i++) {
+		if (fabs(kernel->data[i]) > fabs(kernel->data[pivot])) {
+			pivot = i;
+		}
+	}
+	const double max = kernel->data[pivot];
+	if (max == 0) {
+		return false;
+	}
+	const int px = pivot % w, py = pivot / w;
+
+	// kernel[y][x] = col[y] * row[x], with row being the pivot row
+	double rsum = 0, csum = 0;
+	for (int y = 0; y < h; y++) {
+		double c = kernel->data[y * w + px] / max;
+		csum += c;
+		for (int x = 0; x < w; x++) {
+			double expected = c * kernel->data[py * w + x];
+			// The predefined kernels only have 6 decimal digits
+			if (fabs(kernel->data[y * w + x] - expected) > 1e-5 * fabs(max)) {
+				return false;
+			}
+		}
+	}
+	for (int x = 0; x < w; x++) {
+		rsum += kernel->data[py * w + x];
+	}
+	if (fabs(rsum) < 1e-9 || fabs(csum) < 1e-9) {
+		// Can't be normalized separately
+		return false;
+	}
+
+	*row = cvalloc(sizeof(conv) + (size_t)w * sizeof(double));
+	(*row)->w = w;
+	(*row)->h = 1;
+	(*row)->rsum = NULL;
+	memcpy((*row)->data, &kernel->data[py * w], (size_t)w * sizeof(double));
+
+	*col = cvalloc(sizeof(conv) + (size_t)h * sizeof(double));
+	(*col)->w = 1;
+	(*col)->h = h;
+	(*col)->rsum = NULL;
+	for (int y = 0; y < h; y++) {
+		(*col)->data[y] = kernel->data[y * w + px] / max;
+	}
+	return true;
+}
+
+TEST_CASE(split_separable_kernel) {
+	conv *row, *col;
+	auto kernel = gaussian_kernel(1.5, 5);
+	TEST_TRUE(split_separable_kernel(kernel, &row, &col));
+	TEST_EQUAL(row->w, 5);
+	TEST_EQUAL(row->h, 1);
+	TEST_EQUAL(col->w, 1);
+	TEST_EQUAL(col->h, 5);
+	for (int y = 0; y < 5; y++) {
+		for (int x = 0; x < 5; x++) {
+			TEST_TRUE(fabs(col->data[y] * row->data[x] - kernel->data[y * 5 + x]) <
+			          1e-9);
+		}
+	}
+	free(row);
+	free(col);
+
+	// Not separable
+	kernel->data[0] += 0.1;
+	TEST_TRUE(!split_separable_kernel(kernel, &row, &col));
+	free(kernel);
+}
+
 /// preprocess kernels to make shadow generation faster
 /// shadow_sum[x*d+y] is the sum of the kernel from (0, 0) to (x, y), inclusive
 void sum_kernel_preprocess(conv *map) {
@@ -2,6 +2,7 @@
 // Copyright (c) Yuxuan Shui <yshuiv7@gmail.com>
 
 #pragma once
+#include <stdbool.h>
 #include <stdlib.h>
 #include "utils/compiler.h"
 
@@ -29,6 +30,12 @@ conv *gaussian_kernel(double r, int size);
 /// @param[in] shadow_radius the radius of the shadow
 conv *gaussian_kernel_autodetect_deviation(int shadow_radius);
 
+/// Split a separable (rank 1) kernel into a horizontal (w x 1) and a vertical (1 x h)
+/// kernel, so that applying both in turn is the same as applying `kernel`, up to
+/// normalization. Returns false and leaves `row` and `col` untouched if `kernel` is
+/// not separable.
+bool split_separable_kernel(const conv *kernel, conv **row, conv **col);
+
 /// preprocess kernels to make shadow generation faster
 /// shadow_sum[x*d+y] is the sum of the kernel from (0, 0) to (x, y), inclusive
 void sum_kernel_preprocess(conv *map);
@@ -127,3 +127,21 @@ TEST_CASE(strtod_simple) {
 	TEST_EQUAL(result, 0.5);
 	TEST_EQUAL(*end, '\0');
 }
+
+char *mstrdup_lower(const char *src) {
+	auto len = strlen(src);
+	auto str = ccalloc(len + 1, char);
+	for (size_t i = 0; i < len; i++) {
+		char c = src[i];
+		str[i] = (char)(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+	}
+	return str;
+}
+
+TEST_CASE(mstrdup_lower) {
+	char *str = mstrdup_lower("XTerm \xc3\x89");
+	TEST_STREQUAL(str, "xterm \xc3\x89");
+	TEST_EQUAL(str_hash(str), str_hash("xterm \xc3\x89"));
+	TEST_TRUE(str_hash(str) != str_hash("XTerm \xc3\x89"));
+	free(str);
+}
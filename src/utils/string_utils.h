@@ -3,6 +3,7 @@
 #pragma once
 #include <ctype.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #include "utils/compiler.h"
 
@@ -15,6 +16,19 @@ void mstrextend(char **psrc1, const char *src2);
 /// Parse a floating point number of form (+|-)?[0-9]*(\.[0-9]*)
 double strtod_simple(const char *, const char **);
 
+/// Duplicate a string, with ASCII letters folded to lower case, which is what
+/// strcasecmp ignores in UTF-8 locales.
+char *mstrdup_lower(const char *src);
+
+/// FNV-1a hash of a string
+static inline uint32_t str_hash(const char *src) {
+	uint32_t hash = 2166136261u;
+	for (; *src; src++) {
+		hash = (hash ^ (unsigned char)*src) * 16777619u;
+	}
+	return hash;
+}
+
 static inline int uitostr(unsigned int n, char *buf) {
 	int ret = 0;
 	unsigned int tmp = n;
@@ -23,11 +23,13 @@
 
 #include "atom.h"
 #include "backend/backend.h"
+#include "backend/backend_common.h"
 #include "c2.h"
 #include "common.h"
 #include "config.h"
 #include "log.h"
 #include "picom.h"
+#include "prop_cache.h"
 #include "region.h"
 #include "compton-compat/render.h"
 #include "types.h"
@@ -269,7 +271,7 @@ static inline void win_release_shadow(backend_t *base, struct managed_win *w) {
 	log_debug("Releasing shadow of window %#010x (%s)", w->base.id, w->name);
 	assert(w->shadow_image);
 	if (w->shadow_image) {
-		base->ops->release_image(base, w->shadow_image);
+		backend_release_shadow(base, w->shadow_image);
 		w->shadow_image = NULL;
 		w->flags |= WIN_FLAGS_SHADOW_NONE;
 	}
@@ -303,8 +305,7 @@ bool win_bind_shadow(struct backend_base *b, struct managed_win *w, struct color
                      struct conv *kernel) {
 	assert(!w->shadow_image);
 	assert(w->shadow);
-	w->shadow_image = b->ops->render_shadow(b, w->widthb, w->heightb, kernel, c.red,
-	                                        c.green, c.blue, c.alpha);
+	w->shadow_image = backend_render_shadow(b, w->widthb, w->heightb, kernel, c);
 	if (!w->shadow_image) {
 		log_error("Failed to bind shadow image, shadow will be disabled for "
 		          "%#010x (%s)",
@@ -425,29 +426,103 @@ static bool attr_pure win_has_rounded_corners(const struct managed_win *w) {
 	return false;
 }
 
+/**
+ * Get a property of `wid`, the client or frame window of `w`.
+ *
+ * Like in c2, the property cache is only used while `w` is mapped, since we then get
+ * told about property changes. When a window is mapped its properties are prefetched
+ * into the cache, see win_prefetch_props.
+ */
+static inline winprop_t win_get_prop(session_t *ps, const struct managed_win *w,
+                                     xcb_window_t wid, xcb_atom_t atom, int length,
+                                     xcb_atom_t rtype, int rformat) {
+	if (w->a.map_state == XCB_MAP_STATE_VIEWABLE) {
+		return prop_cache_get(ps, wid, atom, 0, length, rtype, rformat);
+	}
+	return x_get_prop(ps, wid, atom, length, rtype, rformat);
+}
+
+/**
+ * Get a text property of `wid`, see win_get_prop.
+ */
+static inline bool win_get_text_prop(session_t *ps, const struct managed_win *w,
+                                     xcb_window_t wid, xcb_atom_t atom, char ***pstrlst,
+                                     int *pnstr) {
+	if (w->a.map_state == XCB_MAP_STATE_VIEWABLE) {
+		return prop_cache_get_text(ps, wid, atom, pstrlst, pnstr);
+	}
+	return wid_get_text_prop(ps, wid, atom, pstrlst, pnstr);
+}
+
+/**
+ * Check if `wid` has a property, see win_get_prop.
+ */
+static inline bool win_has_prop(session_t *ps, const struct managed_win *w,
+                                xcb_window_t wid, xcb_atom_t atom) {
+	if (w->a.map_state == XCB_MAP_STATE_VIEWABLE) {
+		return prop_cache_has(ps, wid, atom);
+	}
+	return wid_has_prop(ps, wid, atom);
+}
+
+/**
+ * Get a window type property of `wid`, see win_get_prop.
+ */
+static inline xcb_window_t win_get_prop_window(session_t *ps, const struct managed_win *w,
+                                               xcb_window_t wid, xcb_atom_t atom) {
+	winprop_t prop = win_get_prop(ps, w, wid, atom, 1L, XCB_ATOM_WINDOW, 32);
+	xcb_window_t p = prop.nitems ? (xcb_window_t)*prop.p32 : XCB_NONE;
+	free_winprop(&prop);
+	return p;
+}
+
+void win_prefetch_props(session_t *ps, xcb_window_t wid) {
+	prop_cache_prefetch(ps, wid, ps->atoms->a_NET_WM_WINDOW_TYPE);
+	prop_cache_prefetch(ps, wid, ps->atoms->aWM_TRANSIENT_FOR);
+	if (ps->o.frame_opacity != 1) {
+		prop_cache_prefetch(ps, wid, ps->atoms->a_NET_FRAME_EXTENTS);
+	}
+	if (ps->o.track_leader && ps->o.detect_client_leader) {
+		prop_cache_prefetch(ps, wid, ps->atoms->aWM_CLIENT_LEADER);
+	}
+	if (ps->o.track_wdata) {
+		prop_cache_prefetch(ps, wid, ps->atoms->a_NET_WM_NAME);
+		prop_cache_prefetch(ps, wid, ps->atoms->aWM_NAME);
+		prop_cache_prefetch(ps, wid, ps->atoms->aWM_CLASS);
+		prop_cache_prefetch(ps, wid, ps->atoms->aWM_WINDOW_ROLE);
+	}
+}
+
+/**
+ * Update the lower case copy and the hashes of a window string.
+ */
+static void win_fold_str(struct win_folded_str *f, const char *str) {
+	free(f->folded);
+	if (!str) {
+		*f = (struct win_folded_str){0};
+		return;
+	}
+	f->folded = mstrdup_lower(str);
+	f->hash = str_hash(str);
+	f->folded_hash = str_hash(f->folded);
+}
+
 int win_update_name(session_t *ps, struct managed_win *w) {
-	XTextProperty text_prop = {NULL, XCB_NONE, 0, 0};
 	char **strlst = NULL;
 	int nstr = 0;
 
 	if (!w->client_win)
 		return 0;
 
-	if (!(wid_get_text_prop(ps, w->client_win, ps->atoms->a_NET_WM_NAME, &strlst, &nstr))) {
+	if (!win_get_text_prop(ps, w, w->client_win, ps->atoms->a_NET_WM_NAME, &strlst,
+	                       &nstr)) {
 		log_trace("(%#010x): _NET_WM_NAME unset, falling back to WM_NAME.",
 		          w->client_win);
 
-		if (!(XGetWMName(ps->dpy, w->client_win, &text_prop) && text_prop.value)) {
-			return -1;
-		}
-		if (Success != XmbTextPropertyToTextList(ps->dpy, &text_prop, &strlst, &nstr) ||
-		    !nstr || !strlst) {
-			if (strlst)
-				XFreeStringList(strlst);
-			XFree(text_prop.value);
+		if (!win_get_text_prop(ps, w, w->client_win, ps->atoms->aWM_NAME, &strlst,
+		                       &nstr)) {
 			return -1;
 		}
-		XFree(text_prop.value);
 	}
 
 	int ret = 0;
@@ -455,6 +530,7 @@ int win_update_name(session_t *ps, struct managed_win *w) {
 		ret = 1;
 		free(w->name);
 		w->name = strdup(strlst[0]);
+		win_fold_str(&w->name_folded, w->name);
 	}
 
 	XFreeStringList(strlst);
@@ -469,7 +545,8 @@ int win_get_role(session_t *ps, struct managed_win *w) {
 	char **strlst = NULL;
 	int nstr = 0;
 
-	if (!wid_get_text_prop(ps, w->client_win, ps->atoms->aWM_WINDOW_ROLE, &strlst, &nstr))
+	if (!win_get_text_prop(ps, w, w->client_win, ps->atoms->aWM_WINDOW_ROLE, &strlst,
+	                       &nstr))
 		return -1;
 
 	int ret = 0;
@@ -477,6 +554,7 @@ int win_get_role(session_t *ps, struct managed_win *w) {
 		ret = 1;
 		free(w->role);
 		w->role = strdup(strlst[0]);
+		win_fold_str(&w->role_folded, w->role);
 	}
 
 	XFreeStringList(strlst);
@@ -506,9 +584,10 @@ static inline bool win_bounding_shaped(const session_t *ps, xcb_window_t wid) {
 	return false;
 }
 
-static wintype_t wid_get_prop_wintype(session_t *ps, xcb_window_t wid) {
-	winprop_t prop =
-	    x_get_prop(ps, wid, ps->atoms->a_NET_WM_WINDOW_TYPE, 32L, XCB_ATOM_ATOM, 32);
+static wintype_t
+wid_get_prop_wintype(session_t *ps, const struct managed_win *w, xcb_window_t wid) {
+	winprop_t prop = win_get_prop(ps, w, wid, ps->atoms->a_NET_WM_WINDOW_TYPE, 32L,
+	                              XCB_ATOM_ATOM, 32);
 
 	for (unsigned i = 0; i < prop.nitems; ++i) {
 		for (wintype_t j = 1; j < NUM_WINTYPES; ++j) {
@@ -890,36 +969,48 @@ void win_update_opacity_rule(session_t *ps, struct managed_win *w) {
  * Function to be called on window type changes.
  */
 static void win_on_wtype_change(session_t *ps, struct managed_win *w) {
+	// The wintypes options apply regardless of the condition lists
 	win_determine_shadow(ps, w);
 	win_update_focused(ps, w);
-	if (ps->o.invert_color_list)
-		win_determine_invert_color(ps, w);
-	if (ps->o.opacity_rules)
-		win_update_opacity_rule(ps, w);
+	win_on_factor_change(ps, w, C2_DEP_WINDOW_TYPE);
 }
 
 /**
  * Function to be called on window data changes.
  *
+ * The results of matching the condition lists are kept in the window, a list is only
+ * matched again if something it depends on changed.
+ *
+ * @param changed what changed about the window, a mask of enum c2_dep
+ *
  * TODO need better name
  */
-void win_on_factor_change(session_t *ps, struct managed_win *w) {
-	if (ps->o.shadow_blacklist)
+void win_on_factor_change(session_t *ps, struct managed_win *w, unsigned int changed) {
+	unsigned int shadow_deps = c2_list_get_deps(ps->o.shadow_blacklist);
+	if (ps->o.shadow_ignore_shaped) {
+		// shadow-ignore-shaped looks at the bounding shape and rounded corners,
+		// which are updated together with C2_DEP_OTHER
+		shadow_deps |= C2_DEP_OTHER;
+	}
+	if (changed & shadow_deps)
 		win_determine_shadow(ps, w);
-	if (ps->o.invert_color_list)
+	if (changed & c2_list_get_deps(ps->o.invert_color_list))
 		win_determine_invert_color(ps, w);
-	if (ps->o.focus_blacklist)
+	if (changed & c2_list_get_deps(ps->o.focus_blacklist))
 		win_update_focused(ps, w);
-	if (ps->o.opacity_rules)
+	if (changed & c2_list_get_deps(ps->o.opacity_rules))
 		win_update_opacity_rule(ps, w);
-	if (w->a.map_state == XCB_MAP_STATE_VIEWABLE && ps->o.paint_blacklist)
+	if (w->a.map_state == XCB_MAP_STATE_VIEWABLE &&
+	    (changed & c2_list_get_deps(ps->o.paint_blacklist)))
 		w->paint_excluded = c2_match(ps, w, ps->o.paint_blacklist, NULL);
-	if (w->a.map_state == XCB_MAP_STATE_VIEWABLE && ps->o.unredir_if_possible_blacklist)
+	if (w->a.map_state == XCB_MAP_STATE_VIEWABLE &&
+	    (changed & c2_list_get_deps(ps->o.unredir_if_possible_blacklist)))
 		w->unredir_if_possible_excluded =
 		    c2_match(ps, w, ps->o.unredir_if_possible_blacklist, NULL);
 	w->reg_ignore_valid = false;
 
-	module_emit(MODEV_WIN_CHANGED, ps, w);
+	struct modev_win_changed ev = {.w = w, .changed = changed};
+	module_emit(MODEV_WIN_CHANGED, ps, &ev);
 }
 
 /**
@@ -951,14 +1042,14 @@ void win_update_wintype(session_t *ps, struct managed_win *w) {
 	const wintype_t wtype_old = w->window_type;
 
 	// Detect window type here
-	w->window_type = wid_get_prop_wintype(ps, w->client_win);
+	w->window_type = wid_get_prop_wintype(ps, w, w->client_win);
 
 	// Conform to EWMH standard, if _NET_WM_WINDOW_TYPE is not present, take
 	// override-redirect windows or windows without WM_TRANSIENT_FOR as
 	// _NET_WM_WINDOW_TYPE_NORMAL, otherwise as _NET_WM_WINDOW_TYPE_DIALOG.
 	if (WINTYPE_UNKNOWN == w->window_type) {
 		if (w->a.override_redirect ||
-		    !wid_has_prop(ps, w->client_win, ps->atoms->aWM_TRANSIENT_FOR))
+		    !win_has_prop(ps, w, w->client_win, ps->atoms->aWM_TRANSIENT_FOR))
 			w->window_type = WINTYPE_NORMAL;
 		else
 			w->window_type = WINTYPE_DIALOG;
@@ -983,13 +1074,19 @@ void win_mark_client(session_t *ps, struct managed_win *w, xcb_window_t client)
 	if (w->a.map_state != XCB_MAP_STATE_VIEWABLE)
 		return;
 
-	auto e = xcb_request_check(
-	    ps->c, xcb_change_window_attributes(
-	               ps->c, client, XCB_CW_EVENT_MASK,
-	               (const uint32_t[]){determine_evmask(ps, client, WIN_EVMODE_CLIENT)}));
-	if (e) {
-		log_error("Failed to change event mask of window %#010x", client);
-		free(e);
+	// Not checked, this only fails if the client is already gone, and then so is the
+	// frame.
+	set_ignore_cookie(
+	    ps, xcb_change_window_attributes(
+	            ps->c, client, XCB_CW_EVENT_MASK,
+	            (const uint32_t[]){determine_evmask(ps, client, WIN_EVMODE_CLIENT)}));
+
+	// Ask for all the properties read below at once, after selecting property
+	// changes so none are missed. Nothing is sent for the ones already prefetched.
+	win_prefetch_props(ps, client);
+	xcb_get_window_attributes_cookie_t acookie = {0};
+	if (client != w->base.id) {
+		acookie = xcb_get_window_attributes(ps->c, client);
 	}
 
 	win_update_wintype(ps, w);
@@ -1010,13 +1107,17 @@ void win_mark_client(session_t *ps, struct managed_win *w, xcb_window_t client)
 	}
 
 	// Update everything related to conditions
-	win_on_factor_change(ps, w);
+	win_on_factor_change(ps, w, C2_DEP_ALL);
 
 	// Update window focus state
 	win_update_focused(ps, w);
 
-	auto r = xcb_get_window_attributes_reply(
-	    ps->c, xcb_get_window_attributes(ps->c, w->client_win), NULL);
+	if (client == w->base.id) {
+		w->client_pictfmt = w->pictfmt;
+		return;
+	}
+
+	auto r = xcb_get_window_attributes_reply(ps->c, acookie, NULL);
 	if (!r) {
 		log_error("Failed to get client window attributes");
 		return;
@@ -1041,6 +1142,8 @@ void win_unmark_client(session_t *ps, struct managed_win *w) {
 	xcb_change_window_attributes(
 	    ps->c, client, XCB_CW_EVENT_MASK,
 	    (const uint32_t[]){determine_evmask(ps, client, WIN_EVMODE_UNKNOWN)});
+	// We might not be told about its property changes anymore
+	prop_cache_invalidate_window(ps->prop_cache, client);
 }
 
 /**
@@ -1056,8 +1159,13 @@ static void win_recheck_client(session_t *ps, struct managed_win *w) {
 	// Look for the client window
 
 	// Always recursively look for a window with WM_STATE, as Fluxbox
-	// sets override-redirect flags on all frame windows.
-	xcb_window_t cw = find_client_win(ps, w->base.id);
+	// sets override-redirect flags on all frame windows. The window itself is checked
+	// through the property cache, it is the client of override-redirect windows and
+	// windows not reparented by the window manager.
+	xcb_window_t cw = w->base.id;
+	if (!win_has_prop(ps, w, cw, ps->atoms->aWM_STATE)) {
+		cw = find_client_win(ps, w->base.id);
+	}
 	if (cw) {
 		log_trace("(%#010x): client %#010x", w->base.id, cw);
 	}
@@ -1093,6 +1201,7 @@ void free_win_res(session_t *ps, struct managed_win *w) {
 	// Except when we are called by session_destroy
 
 	pixman_region32_fini(&w->bounding_shape);
+	pixman_region32_fini(&w->pending_damage);
 	// BadDamage may be thrown if the window is destroyed
 	set_ignore_cookie(ps, xcb_damage_destroy(ps->c, w->damage));
 	rc_region_unref(&w->reg_ignore);
@@ -1100,6 +1209,10 @@ void free_win_res(session_t *ps, struct managed_win *w) {
 	free(w->class_instance);
 	free(w->class_general);
 	free(w->role);
+	free(w->name_folded.folded);
+	free(w->class_instance_folded.folded);
+	free(w->class_general_folded.folded);
+	free(w->role_folded.folded);
 }
 
 /// Insert a new window after list_node `prev`
@@ -1150,7 +1263,7 @@ struct win *add_win_above(session_t *ps, xcb_window_t id, xcb_window_t below) {
 /// Query the Xorg for information about window `win`
 /// `win` pointer might become invalid after this function returns
 /// Returns the pointer to the window, might be different from `w`
-struct win *fill_win(session_t *ps, struct win *w) {
+struct win *fill_win(session_t *ps, struct win *w, xcb_get_window_attributes_reply_t *a) {
 	static const struct managed_win win_def = {
 	    // No need to initialize. (or, you can think that
 	    // they are initialized right here).
@@ -1235,6 +1348,7 @@ struct win *fill_win(session_t *ps, struct win *w) {
 
 	// Reject overlay window and already added windows
 	if (w->id == ps->overlay) {
+		free(a);
 		return w;
 	}
 
@@ -1242,13 +1356,11 @@ struct win *fill_win(session_t *ps, struct win *w) {
 	if (duplicated_win) {
 		log_debug("Window %#010x (recorded name: %s) added multiple times", w->id,
 		          duplicated_win->name);
+		free(a);
 		return &duplicated_win->base;
 	}
 
 	log_debug("Managing window %#010x", w->id);
-	xcb_get_window_attributes_cookie_t acookie = xcb_get_window_attributes(ps->c, w->id);
-	xcb_get_window_attributes_reply_t *a =
-	    xcb_get_window_attributes_reply(ps->c, acookie, NULL);
 	if (!a || a->map_state == XCB_MAP_STATE_UNVIEWABLE) {
 		// Failed to get window attributes or geometry probably means
 		// the window is gone already. Unviewable means the window is
@@ -1280,19 +1392,16 @@ struct win *fill_win(session_t *ps, struct win *w) {
 	new->base.managed = true;
 	new->a = *a;
 	pixman_region32_init(&new->bounding_shape);
+	pixman_region32_init(&new->pending_damage);
 
 	free(a);
 
 	// Create Damage for window (if not Input Only)
+	// Not checked, to not wait for a round trip for every new window. This only fails
+	// if the window is already gone, we will get a DestroyNotify for it then.
 	new->damage = x_new_id(ps->c);
-	xcb_generic_error_t *e = xcb_request_check(
-	    ps->c, xcb_damage_create_checked(ps->c, new->damage, w->id,
-	                                     XCB_DAMAGE_REPORT_LEVEL_NON_EMPTY));
-	if (e) {
-		free(e);
-		free(new);
-		return w;
-	}
+	set_ignore_cookie(ps, xcb_damage_create(ps->c, new->damage, w->id,
+	                                        XCB_DAMAGE_REPORT_LEVEL_NON_EMPTY));
 
 	new->pictfmt = x_get_pictform_for_visual(ps->c, new->a.visual);
 	new->client_pictfmt = NULL;
@@ -1337,7 +1446,7 @@ static inline void win_set_leader(session_t *ps, struct managed_win *w, xcb_wind
 		}
 
 		// Update everything related to conditions
-		win_on_factor_change(ps, w);
+		win_on_factor_change(ps, w, C2_DEP_LEADER);
 	}
 }
 
@@ -1349,10 +1458,12 @@ void win_update_leader(session_t *ps, struct managed_win *w) {
 
 	// Read the leader properties
 	if (ps->o.detect_transient && !leader)
-		leader = wid_get_prop_window(ps, w->client_win, ps->atoms->aWM_TRANSIENT_FOR);
+		leader = win_get_prop_window(ps, w, w->client_win,
+		                             ps->atoms->aWM_TRANSIENT_FOR);
 
 	if (ps->o.detect_client_leader && !leader)
-		leader = wid_get_prop_window(ps, w->client_win, ps->atoms->aWM_CLIENT_LEADER);
+		leader = win_get_prop_window(ps, w, w->client_win,
+		                             ps->atoms->aWM_CLIENT_LEADER);
 
 	win_set_leader(ps, w, leader);
 
@@ -1403,9 +1514,12 @@ bool win_get_class(session_t *ps, struct managed_win *w) {
 	free(w->class_general);
 	w->class_instance = NULL;
 	w->class_general = NULL;
+	win_fold_str(&w->class_instance_folded, NULL);
+	win_fold_str(&w->class_general_folded, NULL);
 
 	// Retrieve the property string list
-	if (!wid_get_text_prop(ps, w->client_win, ps->atoms->aWM_CLASS, &strlst, &nstr))
+	if (!win_get_text_prop(ps, w, w->client_win, ps->atoms->aWM_CLASS, &strlst,
+	                       &nstr))
 		return false;
 
 	// Copy the strings if successful
@@ -1413,6 +1527,8 @@ bool win_get_class(session_t *ps, struct managed_win *w) {
 
 	if (nstr > 1)
 		w->class_general = strdup(strlst[1]);
+	win_fold_str(&w->class_instance_folded, w->class_instance);
+	win_fold_str(&w->class_general_folded, w->class_general);
 
 	XFreeStringList(strlst);
 
@@ -1462,7 +1578,7 @@ static void win_on_focus_change(session_t *ps, struct managed_win *w) {
 	}
 
 	// Update everything related to conditions
-	win_on_factor_change(ps, w);
+	win_on_factor_change(ps, w, C2_DEP_FOCUS);
 
 	if (win_is_focused_real(ps, w)) {
 		module_emit(MODEV_WIN_FOCUSIN, ps, &w->base);
@@ -1583,7 +1699,7 @@ void win_update_bounding_shape(session_t *ps, struct managed_win *w) {
 	free_paint(ps, &w->paint);
 	free_paint(ps, &w->shadow_paint);
 
-	win_on_factor_change(ps, w);
+	win_on_factor_change(ps, w, C2_DEP_GEOMETRY | C2_DEP_OTHER);
 }
 
 /**
@@ -1610,8 +1726,8 @@ void win_update_opacity_prop(session_t *ps, struct managed_win *w) {
  * Retrieve frame extents from a window.
  */
 void win_update_frame_extents(session_t *ps, struct managed_win *w, xcb_window_t client) {
-	winprop_t prop = x_get_prop(ps, client, ps->atoms->a_NET_FRAME_EXTENTS, 4L,
-	                            XCB_ATOM_CARDINAL, 32);
+	winprop_t prop = win_get_prop(ps, w, client, ps->atoms->a_NET_FRAME_EXTENTS, 4L,
+	                              XCB_ATOM_CARDINAL, 32);
 
 	if (prop.nitems == 4) {
 		const int32_t extents[4] = {
@@ -1656,6 +1772,7 @@ bool win_is_region_ignore_valid(session_t *ps, const struct managed_win *w) {
  */
 void win_ev_stop(session_t *ps, const struct win *w) {
 	xcb_change_window_attributes(ps->c, w->id, XCB_CW_EVENT_MASK, (const uint32_t[]){0});
+	prop_cache_invalidate_window(ps->prop_cache, w->id);
 
 	if (!w->managed) {
 		return;
@@ -1665,6 +1782,7 @@ void win_ev_stop(session_t *ps, const struct win *w) {
 	if (mw->client_win) {
 		xcb_change_window_attributes(ps->c, mw->client_win, XCB_CW_EVENT_MASK,
 		                             (const uint32_t[]){0});
+		prop_cache_invalidate_window(ps->prop_cache, mw->client_win);
 	}
 
 	if (ps->shape_exists) {
@@ -1858,6 +1976,11 @@ bool destroy_win_start(session_t *ps, struct win *w) {
 	// and mapped, since we might still need to render it (e.g. fading out). Window
 	// will be removed from the stack when it finishes destroying.
 	HASH_DEL(ps->windows, w);
+	// The window id can be reused
+	prop_cache_invalidate_window(ps->prop_cache, w->id);
+	if (w->managed && mw->client_win) {
+		prop_cache_invalidate_window(ps->prop_cache, mw->client_win);
+	}
 
 	if (!w->managed || mw->state == WSTATE_UNMAPPED) {
 		// Window is already unmapped, or is an unmanged window, just destroy it
@@ -1994,6 +2117,14 @@ void win_update_screen(session_t *ps, struct managed_win *w) {
 
 /// Map an already registered window
 void map_win_start(session_t *ps, struct managed_win *w) {
+	xcb_get_geometry_reply_t *g =
+	    xcb_get_geometry_reply(ps->c, xcb_get_geometry(ps->c, w->base.id), NULL);
+	map_win_start_with_geometry(ps, w, g);
+	free(g);
+}
+
+void map_win_start_with_geometry(session_t *ps, struct managed_win *w,
+                                 const xcb_get_geometry_reply_t *g) {
 	assert(ps->server_grabbed);
 	assert(w);
 
@@ -2028,16 +2159,12 @@ void map_win_start(session_t *ps, struct managed_win *w) {
 
 	// We stopped processing window size change when we were unmapped, refresh the
 	// size of the window
-	xcb_get_geometry_cookie_t gcookie = xcb_get_geometry(ps->c, w->base.id);
-	xcb_get_geometry_reply_t *g = xcb_get_geometry_reply(ps->c, gcookie, NULL);
-
 	if (!g) {
 		log_error("Failed to get the geometry of window %#010x", w->base.id);
 		return;
 	}
 
 	w->g = *g;
-	free(g);
 
 	win_on_win_size_change(ps, w);
 	log_trace("Window size: %dx%d", w->g.width, w->g.height);
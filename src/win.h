@@ -27,6 +27,7 @@
 typedef int windata_cookie_t; // Used for modules
 
 struct backend_base;
+struct backend_shadow;
 typedef struct session session_t;
 typedef struct _glx_texture glx_texture_t;
 
@@ -91,12 +92,23 @@ struct win {
 	/// Always false if `is_new` is true.
 	bool managed : 1;
 };
+
+/// A window string folded to lower case, and hashes of it, see win_fold_str
+struct win_folded_str {
+	/// The string with ASCII letters folded to lower case, NULL if it is unset
+	char *folded;
+	/// Hash of the original string
+	uint32_t hash;
+	/// Hash of the folded string
+	uint32_t folded_hash;
+};
+
 struct managed_win {
 	struct win base;
 	/// backend data attached to this window. Only available when
 	/// `state` is not UNMAPPED
 	void *win_image;
-	void *shadow_image;
+	struct backend_shadow *shadow_image;
 	/// Pointer to the next higher window to paint.
 	struct managed_win *prev_trans;
 	/// Number of windows above this window
@@ -122,6 +134,9 @@ struct managed_win {
 	bool ever_damaged;
 	/// Whether the window was damaged after last paint.
 	bool pixmap_damaged;
+	/// Whether the damage object of the window has damage we haven't subtracted
+	/// and fetched yet.
+	bool damage_fetch_pending;
 	/// Damage of the window.
 	xcb_damage_damage_t damage;
 	/// Paint info of the window.
@@ -134,6 +149,8 @@ struct managed_win {
 	int_fast16_t flags;
 	region_t reg_bound;
 	region_t reg_paint_in_bound;
+	/// Content damage reported since the last frame, in global coordinates.
+	region_t pending_damage;
 	/// The region of screen that will be obscured when windows above is painted,
 	/// in global coordinates.
 	/// We use this to reduce the pixels that needed to be paint when painting
@@ -188,6 +205,12 @@ struct managed_win {
 	char *class_general;
 	/// <code>WM_WINDOW_ROLE</code> value of the window.
 	char *role;
+	/// Lower case copies and hashes of the strings above, so conditions don't have
+	/// to fold them every time they are matched. Updated by win_fold_str.
+	struct win_folded_str name_folded;
+	struct win_folded_str class_instance_folded;
+	struct win_folded_str class_general_folded;
+	struct win_folded_str role_folded;
 
 	// Opacity-related members
 	/// Current window opacity.
@@ -268,6 +291,10 @@ void unmap_win_start(struct session *, struct managed_win *);
 /// Start the mapping of a window. We cannot map immediately since we might need to fade
 /// the window in.
 void map_win_start(struct session *, struct managed_win *);
+/// Same as map_win_start, with the reply of a GetGeometry request already sent for the
+/// window. `g` can be NULL if the request failed.
+void map_win_start_with_geometry(struct session *, struct managed_win *,
+                                 const xcb_get_geometry_reply_t *g);
 
 /// Start the destroying of a window. Windows cannot always be destroyed immediately
 /// because of fading and such.
@@ -290,13 +317,18 @@ void win_set_focused(session_t *ps, struct managed_win *w);
 bool attr_pure win_should_fade(session_t *ps, const struct managed_win *w);
 void win_update_prop_shadow_raw(session_t *ps, struct managed_win *w);
 void win_update_prop_shadow(session_t *ps, struct managed_win *w);
-void win_on_factor_change(session_t *ps, struct managed_win *w);
+void win_on_factor_change(session_t *ps, struct managed_win *w, unsigned int changed);
 /**
  * Update cache data in struct _win that depends on window size.
  */
 void win_on_win_size_change(session_t *ps, struct managed_win *w);
 void win_update_wintype(session_t *ps, struct managed_win *w);
 void win_mark_client(session_t *ps, struct managed_win *w, xcb_window_t client);
+/// Ask the X server for the properties of `wid` that are read when a window with it as
+/// client is mapped, without waiting for the replies. The replies go to the property
+/// cache, so property changes of `wid` must be selected by the time anything else can
+/// change them, i.e. before the server is ungrabbed.
+void win_prefetch_props(session_t *ps, xcb_window_t wid);
 void win_unmark_client(session_t *ps, struct managed_win *w);
 bool win_get_class(session_t *ps, struct managed_win *w);
 
@@ -375,7 +407,9 @@ struct win *add_win_above(session_t *ps, xcb_window_t id, xcb_window_t below);
 struct win *add_win_top(session_t *ps, xcb_window_t id);
 /// Query the Xorg for information about window `win`
 /// `win` pointer might become invalid after this function returns
-struct win *fill_win(session_t *ps, struct win *win);
+/// `a` is the reply of a GetWindowAttributes request for `win`, or NULL if it failed.
+/// It is freed by fill_win.
+struct win *fill_win(session_t *ps, struct win *win, xcb_get_window_attributes_reply_t *a);
 /// Move window `w` to be right above `below`
 void restack_above(session_t *ps, struct win *w, xcb_window_t below);
 /// Move window `w` to the bottom of the stack
@@ -270,6 +270,12 @@ bool x_fetch_region(xcb_connection_t *c, xcb_xfixes_region_t r, pixman_region32_
 		return false;
 	}
 
+	bool ret = x_region_from_fetch_reply(xr, res);
+	free(xr);
+	return ret;
+}
+
+bool x_region_from_fetch_reply(xcb_xfixes_fetch_region_reply_t *xr, pixman_region32_t *res) {
 	int nrect = xcb_xfixes_fetch_region_rectangles_length(xr);
 	auto b = ccalloc(nrect, pixman_box32_t);
 	xcb_rectangle_t *xrect = xcb_xfixes_fetch_region_rectangles(xr);
@@ -281,7 +287,6 @@ bool x_fetch_region(xcb_connection_t *c, xcb_xfixes_region_t r, pixman_region32_
 	}
 	bool ret = pixman_region32_init_rects(res, b, nrect);
 	free(b);
-	free(xr);
 	return ret;
 }
 
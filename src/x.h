@@ -186,6 +186,9 @@ x_create_picture_with_visual(xcb_connection_t *, xcb_drawable_t, int w, int h,
 /// Fetch a X region and store it in a pixman region
 bool x_fetch_region(xcb_connection_t *, xcb_xfixes_region_t r, region_t *res);
 
+/// Store the rectangles of a FetchRegion reply in a pixman region. Doesn't free the reply.
+bool x_region_from_fetch_reply(xcb_xfixes_fetch_region_reply_t *, region_t *res);
+
 void x_set_picture_clip_region(xcb_connection_t *, xcb_render_picture_t, int16_t clip_x_origin,
                                int16_t clip_y_origin, const region_t *);
 